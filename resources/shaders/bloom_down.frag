@@ -0,0 +1,70 @@
+#version 330 core
+
+in vec3 uv;
+
+out vec4 fragColor;
+
+// The next larger level of the chain (or the bright color buffer for the first pass)
+uniform sampler2D tex;
+// Only the first pass: weights each group by its brightness so single hot pixels don't flicker
+uniform bool karis;
+// Only the first pass: tex is the full scene color, keep just the HDR parts (as lighting.frag does)
+uniform bool threshold;
+
+float luminance(vec3 c) {
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+float karisWeight(vec3 c) {
+    return 1.0 / (1.0 + luminance(c));
+}
+
+vec3 fetch(vec2 coord) {
+    vec3 c = texture(tex, coord).rgb;
+    return threshold && luminance(c) <= 1.0 ? vec3(0.0) : c;
+}
+
+void main()
+{
+    // 13 bilinear taps covering a 6x6 texel footprint of the source, combined as five
+    // overlapping 2x2 boxes (one in the center, four in the corners)
+    vec2 t = 1.0 / textureSize(tex, 0);
+
+    vec3 a = fetch(uv.xy + t * vec2(-2.0,  2.0));
+    vec3 b = fetch(uv.xy + t * vec2( 0.0,  2.0));
+    vec3 c = fetch(uv.xy + t * vec2( 2.0,  2.0));
+
+    vec3 d = fetch(uv.xy + t * vec2(-2.0,  0.0));
+    vec3 e = fetch(uv.xy);
+    vec3 f = fetch(uv.xy + t * vec2( 2.0,  0.0));
+
+    vec3 g = fetch(uv.xy + t * vec2(-2.0, -2.0));
+    vec3 h = fetch(uv.xy + t * vec2( 0.0, -2.0));
+    vec3 i = fetch(uv.xy + t * vec2( 2.0, -2.0));
+
+    vec3 j = fetch(uv.xy + t * vec2(-1.0,  1.0));
+    vec3 k = fetch(uv.xy + t * vec2( 1.0,  1.0));
+    vec3 l = fetch(uv.xy + t * vec2(-1.0, -1.0));
+    vec3 m = fetch(uv.xy + t * vec2( 1.0, -1.0));
+
+    vec3 center = (j + k + l + m) * 0.25;
+    vec3 topLeft = (a + b + d + e) * 0.25;
+    vec3 topRight = (b + c + e + f) * 0.25;
+    vec3 bottomLeft = (d + e + g + h) * 0.25;
+    vec3 bottomRight = (e + f + h + i) * 0.25;
+
+    vec3 result;
+    if (karis) {
+        float wc = karisWeight(center) * 0.5;
+        float w0 = karisWeight(topLeft) * 0.125;
+        float w1 = karisWeight(topRight) * 0.125;
+        float w2 = karisWeight(bottomLeft) * 0.125;
+        float w3 = karisWeight(bottomRight) * 0.125;
+        result = (center * wc + topLeft * w0 + topRight * w1 + bottomLeft * w2 + bottomRight * w3)
+                 / (wc + w0 + w1 + w2 + w3);
+    } else {
+        result = center * 0.5 + (topLeft + topRight + bottomLeft + bottomRight) * 0.125;
+    }
+
+    fragColor = vec4(result, 1.0);
+}
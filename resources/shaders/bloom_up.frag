@@ -0,0 +1,24 @@
+#version 330 core
+
+in vec3 uv;
+
+out vec4 fragColor;
+
+// The next smaller level of the chain, added onto the level being drawn to
+uniform sampler2D tex;
+// Tent radius in source texels, wider = softer glow
+uniform float radius;
+
+void main()
+{
+    // 3x3 tent filter
+    vec2 t = radius / textureSize(tex, 0);
+
+    vec3 result = texture(tex, uv.xy).rgb * 4.0;
+    result += (texture(tex, uv.xy + vec2(-t.x, 0.0)).rgb + texture(tex, uv.xy + vec2(t.x, 0.0)).rgb
+             + texture(tex, uv.xy + vec2(0.0, -t.y)).rgb + texture(tex, uv.xy + vec2(0.0, t.y)).rgb) * 2.0;
+    result += texture(tex, uv.xy + vec2(-t.x, -t.y)).rgb + texture(tex, uv.xy + vec2(t.x, -t.y)).rgb
+            + texture(tex, uv.xy + vec2(-t.x, t.y)).rgb + texture(tex, uv.xy + vec2(t.x, t.y)).rgb;
+
+    fragColor = vec4(result / 16.0, 1.0);
+}
@@ -0,0 +1,5 @@
+#version 330 core
+
+// Depth only, color writes are masked off
+void main() {
+}
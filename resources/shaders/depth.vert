@@ -0,0 +1,19 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+// Per-instance transform for template instances, identity for everything else
+layout (location = 2) in mat4 instance_mat;
+
+uniform mat4 model_mat;
+uniform mat4 mvp_mat;   // view_proj * model_mat, from the CPU
+uniform mat4 view_proj;
+uniform bool instanced;
+
+// Must compute gl_Position exactly like lighting.vert, the shading pass tests for equal depth
+invariant gl_Position;
+
+void main() {
+    // Instances can't share one mvp, they go through the instance transform
+    gl_Position = instanced ? view_proj * (instance_mat * (model_mat * vec4(position, 1.0)))
+                            : mvp_mat * vec4(position, 1.0);
+}
@@ -1,14 +1,41 @@
 #version 330 core
 
 in vec3 col;
-out vec4 fragColor;
-out vec4 brightColor;
+in vec2 corner;
+in float view_depth;
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
+
+// Full resolution scene depth, particles are drawn at 1/depth_scale of it
+uniform sampler2D scene_depth;
+uniform int depth_scale;
+// proj[2][2] and proj[3][2], turn depth buffer values back into view distances
+uniform vec2 depth_params;
+// Particles fade out over this distance in front of the surface behind them
+uniform float soft_distance;
+uniform float radius;
 
 void main() {
+   // Procedural disc instead of tessellated geometry
+   float r2 = dot(corner, corner);
+   if (r2 > 1.0) {
+      discard;
+   }
+   float falloff = 1.0 - r2 * r2;
+
+   // Treated as a sphere, so the fade uses the depth of its front surface at this pixel
+   float depth_here = view_depth - radius * sqrt(1.0 - r2);
+
+   // The same full resolution texel the composite compares against when upsampling
+   float depth = texelFetch(scene_depth, ivec2(gl_FragCoord.xy) * depth_scale, 0).r;
+   float scene = depth_params.y / (depth * 2.0 - 1.0 + depth_params.x);
+   float fade = clamp((scene - depth_here) / soft_distance, 0.0, 1.0) * falloff;
+
    float alpha = 1.f;
-   fragColor = vec4(col, 1);
    if (col.r < 0.9) {
       alpha = col.r;
    }
-   brightColor = vec4(col, alpha);
+   // Premultiplied, so the half resolution targets can be blended over the scene as is
+   fragColor = vec4(col, 1) * fade;
+   brightColor = vec4(col * alpha, alpha) * fade;
 }
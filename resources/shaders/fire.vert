@@ -1,25 +1,28 @@
 #version 330 core
 
-layout (location = 0) in vec3 position;
+// One instance per particle; the billboard's corners come from gl_VertexID, no vertex buffer
 layout (location = 1) in vec3 offset;
 layout (location = 2) in vec3 color;
 out vec3 col;
+out vec2 corner;
+out float view_depth;
 
-uniform mat4 model_mat;
-uniform mat4 view_mat;
-uniform mat4 proj_mat;
-
-vec3 center = vec3(0,0,0);
-vec2 size = vec2(1,1);
+uniform mat4 view_proj;
+// The camera's right, up and backward axes in world space
+uniform vec3 camera_right;
+uniform vec3 camera_up;
+uniform vec3 camera_back;
+uniform float radius;
 
 void main() {
-   vec3 u = vec3(view_mat[0][0], view_mat[1][0], view_mat[2][0]); //right
-   vec3 v = vec3(view_mat[0][1], view_mat[1][1], view_mat[2][1]); //up
-
-   vec3 particle_pos = position+offset;
+   // A 4 vertex triangle strip: (-1,-1), (1,-1), (-1,1), (1,1)
+   corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
 
-   vec3 world_space_pos = center + u*particle_pos.x*size.x + v*particle_pos.y*size.y;
-   mat4 mvp = proj_mat * view_mat * model_mat;
-   gl_Position = mvp * vec4(world_space_pos, 1.0);
+   // The fire is a sheet facing the camera, offset.z pushes a particle along the view axis
+   vec3 center = camera_right * offset.x + camera_up * offset.y + camera_back * offset.z;
+   vec3 world_space_pos = center + (camera_right * corner.x + camera_up * corner.y) * radius;
+   gl_Position = view_proj * vec4(world_space_pos, 1.0);
    col = color;
+   // Clip w is the distance along the view axis
+   view_depth = gl_Position.w;
 }
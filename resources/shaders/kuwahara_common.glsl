@@ -0,0 +1,102 @@
+// Generalized anisotropic Kuwahara filter (Kyprianidis et al.) with polynomial sector weights,
+// shared by kuwahara.frag and kuwahara.comp. The includer defines
+//     vec3 kuwaharaSample(ivec2 offset)
+// returning the reduced resolution scene color offset pixels away from the one being filtered.
+
+const int N = 8;
+// Upper bound for the kernel radius
+const int MAX_RADIUS = 8;
+// How much the kernel stretches along edges
+const float alpha = 1.0;
+// Sharpness of the sector selection
+const float q = 8.0;
+const float hardness = 8.0;
+
+// st is the structure tensor, already smoothed by kuwahara_tensor_blur.frag.
+// Half extents of the kernel for a given radius are at most 2 * radius
+vec3 kuwaharaFilter(vec3 st, float kernelRadius) {
+    float E = st.x, F = st.y, G = st.z;
+
+    // Eigenvectors give the local orientation, eigenvalues the anisotropy
+    float root = sqrt((E - G) * (E - G) + 4.0 * F * F);
+    float lambda1 = 0.5 * (E + G + root);
+    float lambda2 = 0.5 * (E + G - root);
+    vec2 v = vec2(lambda1 - E, -F);
+    vec2 dir = length(v) > 0.0 ? normalize(v) : vec2(0.0, 1.0);
+    float phi = -atan(dir.y, dir.x);
+    float A = (lambda1 + lambda2 > 0.0) ? (lambda1 - lambda2) / (lambda1 + lambda2) : 0.0;
+
+    float radius = clamp(kernelRadius, 1.0, float(MAX_RADIUS));
+    float a = radius * clamp((alpha + A) / alpha, 0.1, 2.0);
+    float b = radius * clamp(alpha / (alpha + A), 0.1, 2.0);
+
+    float cos_phi = cos(phi);
+    float sin_phi = sin(phi);
+    mat2 R = mat2(cos_phi, -sin_phi, sin_phi, cos_phi);
+    mat2 S = mat2(0.5 / a, 0.0, 0.0, 0.5 / b);
+    mat2 SR = S * R;
+
+    int max_x = min(int(sqrt(a * a * cos_phi * cos_phi + b * b * sin_phi * sin_phi)), 2 * MAX_RADIUS);
+    int max_y = min(int(sqrt(a * a * sin_phi * sin_phi + b * b * cos_phi * cos_phi)), 2 * MAX_RADIUS);
+
+    // Polynomial approximation of the sector weights
+    float zeta = 2.0 / radius;
+    float zeroCross = 0.58;
+    float sinZeroCross = sin(zeroCross);
+    float eta = (zeta + cos(zeroCross)) / (sinZeroCross * sinZeroCross);
+
+    vec4 m[N];
+    vec3 s[N];
+    for (int k = 0; k < N; ++k) {
+        m[k] = vec4(0.0);
+        s[k] = vec3(0.0);
+    }
+
+    for (int y = -max_y; y <= max_y; ++y) {
+        for (int x = -max_x; x <= max_x; ++x) {
+            vec2 p = SR * vec2(x, y);
+            if (dot(p, p) > 0.25) continue;
+
+            vec3 c = kuwaharaSample(ivec2(x, y));
+
+            float w[N];
+            float sum = 0.0;
+            float z, vxx, vyy;
+
+            vxx = zeta - eta * p.x * p.x;
+            vyy = zeta - eta * p.y * p.y;
+            z = max(0.0, p.y + vxx);  w[0] = z * z; sum += w[0];
+            z = max(0.0, -p.x + vyy); w[2] = z * z; sum += w[2];
+            z = max(0.0, -p.y + vxx); w[4] = z * z; sum += w[4];
+            z = max(0.0, p.x + vyy);  w[6] = z * z; sum += w[6];
+
+            vec2 r = 0.70710678 * vec2(p.x - p.y, p.x + p.y);
+            vxx = zeta - eta * r.x * r.x;
+            vyy = zeta - eta * r.y * r.y;
+            z = max(0.0, r.y + vxx);  w[1] = z * z; sum += w[1];
+            z = max(0.0, -r.x + vyy); w[3] = z * z; sum += w[3];
+            z = max(0.0, -r.y + vxx); w[5] = z * z; sum += w[5];
+            z = max(0.0, r.x + vyy);  w[7] = z * z; sum += w[7];
+
+            float g = exp(-3.125 * dot(p, p)) / max(sum, 1e-6);
+            for (int k = 0; k < N; ++k) {
+                float wk = w[k] * g;
+                m[k] += vec4(c * wk, wk);
+                s[k] += c * c * wk;
+            }
+        }
+    }
+
+    // Sectors with low variance dominate the result
+    vec4 result = vec4(0.0);
+    for (int k = 0; k < N; ++k) {
+        if (m[k].w <= 0.0) continue;
+        vec3 mean = m[k].rgb / m[k].w;
+        vec3 variance = abs(s[k] / m[k].w - mean * mean);
+        float sigma2 = variance.r + variance.g + variance.b;
+        float wk = 1.0 / (1.0 + pow(hardness * 1000.0 * sigma2, 0.5 * q));
+        result += vec4(mean * wk, wk);
+    }
+
+    return result.w > 0.0 ? result.rgb / result.w : kuwaharaSample(ivec2(0));
+}
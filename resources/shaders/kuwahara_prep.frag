@@ -0,0 +1,40 @@
+#version 330 core
+
+in vec3 uv;
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 tensor;
+
+// Full resolution scene color
+uniform sampler2D u_tex;
+// 1 / size of the reduced resolution target
+uniform vec2 u_texelSize;
+
+float luminance(vec3 c) {
+    return dot(c, vec3(0.299, 0.587, 0.114));
+}
+
+void main() {
+    // Box-filtered scene at the filter's resolution, from four bilinear taps around the center
+    vec2 h = 0.25 * u_texelSize;
+    vec3 color = texture(u_tex, uv.xy + vec2(-h.x, -h.y)).rgb + texture(u_tex, uv.xy + vec2(h.x, -h.y)).rgb
+               + texture(u_tex, uv.xy + vec2(-h.x, h.y)).rgb + texture(u_tex, uv.xy + vec2(h.x, h.y)).rgb;
+    fragColor = vec4(color * 0.25, 1.0);
+
+    // Sobel gradients of the luminance at the target's pixel spacing
+    vec2 t = u_texelSize;
+    float tl = luminance(texture(u_tex, uv.xy + vec2(-t.x,  t.y)).rgb);
+    float tc = luminance(texture(u_tex, uv.xy + vec2( 0.0,  t.y)).rgb);
+    float tr = luminance(texture(u_tex, uv.xy + vec2( t.x,  t.y)).rgb);
+    float ml = luminance(texture(u_tex, uv.xy + vec2(-t.x,  0.0)).rgb);
+    float mr = luminance(texture(u_tex, uv.xy + vec2( t.x,  0.0)).rgb);
+    float bl = luminance(texture(u_tex, uv.xy + vec2(-t.x, -t.y)).rgb);
+    float bc = luminance(texture(u_tex, uv.xy + vec2( 0.0, -t.y)).rgb);
+    float br = luminance(texture(u_tex, uv.xy + vec2( t.x, -t.y)).rgb);
+
+    float gx = ((tr + 2.0 * mr + br) - (tl + 2.0 * ml + bl)) * 0.25;
+    float gy = ((tl + 2.0 * tc + tr) - (bl + 2.0 * bc + br)) * 0.25;
+
+    // Structure tensor (E, F, G), smoothed by the separable blur passes
+    tensor = vec4(gx * gx, gx * gy, gy * gy, 1.0);
+}
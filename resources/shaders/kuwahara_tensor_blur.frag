@@ -0,0 +1,25 @@
+#version 330 core
+
+// One direction of the separable Gaussian that smooths the structure tensor before the filter
+// derives its orientation from it. Run horizontally, then vertically.
+
+in vec3 uv;
+out vec4 fragColor;
+
+// Structure tensor at the filter's reduced resolution
+uniform sampler2D u_tex;
+// One texel along the blur direction, in uv units
+uniform vec2 u_direction;
+
+// sigma = 2 texels
+const int TAPS = 4;
+const float weights[TAPS + 1] = float[](0.2042, 0.1802, 0.1238, 0.0663, 0.0276);
+
+void main() {
+    vec3 sum = texture(u_tex, uv.xy).rgb * weights[0];
+    for (int i = 1; i <= TAPS; i++) {
+        sum += texture(u_tex, uv.xy + float(i) * u_direction).rgb * weights[i];
+        sum += texture(u_tex, uv.xy - float(i) * u_direction).rgb * weights[i];
+    }
+    fragColor = vec4(sum, 1.0);
+}
@@ -2,9 +2,14 @@
 
 layout (location = 0) out vec4 fragColor;
 layout (location = 1) out vec4 brightColor;
+// Screen space motion since last frame in uv units, for TAA
+layout (location = 2) out vec4 velocity;
 
 in vec3 world_pos;
 in vec3 world_norm;
+in vec2 uv;
+in vec4 curr_clip;
+in vec4 prev_clip;
 
 uniform vec3 camera_pos;
 uniform float ka;
@@ -15,8 +20,14 @@ uniform vec4 ambient;
 uniform vec4 diffuse;
 uniform vec4 specular;
 
+// Material texture: a layer of material_textures (see TextureManager), -1 for none.
+// The diffuse color is blended towards it by texture_blend.
+uniform sampler2DArray material_textures;
+uniform int texture_layer;
+uniform vec2 texture_repeat;
+uniform float texture_blend;
+
 struct Light {
-    int id;
     int type;
     vec4 color;
     vec3 function;
@@ -24,52 +35,117 @@ struct Light {
     vec4 dir;
     float penumbra;
     float angle;
-    float width, height;
+    int shadow; // Layer in the shadow maps, -1 for none
 };
-uniform int light_size;
-uniform Light lights[8];
+
+// Clustered lighting (see LightClusters): every light is 4 texels in light_data, directional
+// lights first. cluster_grid holds an (offset, count) range of cluster_lights per froxel.
+uniform samplerBuffer light_data;
+uniform usamplerBuffer cluster_grid;
+uniform usamplerBuffer cluster_lights;
+uniform ivec3 cluster_dims;
+uniform vec2 cluster_slicing; // slice = log(view depth) * x + y
+uniform int directional_count;
+uniform mat4 view_mat;
+uniform vec2 screen_size;
+
+// Shadow maps (see ShadowMaps): cascades of the first directional light and one layer per spot light
+uniform sampler2DArrayShadow cascade_shadows;
+uniform sampler2DArrayShadow spot_shadows;
+uniform mat4 cascade_matrices[3];
+uniform vec3 cascade_splits;  // Far view depth of each cascade
+uniform vec3 cascade_texels;  // World size of a texel of each cascade
+uniform mat4 spot_matrices[4];
+
+// Sky cubemap, sampled at a low mip for ambient light when env_ambient > 0
+uniform samplerCube sky_env;
+uniform float env_ambient;
+uniform float env_lod;
 
 uniform float max_dist;
 uniform float min_dist;
 
-//skydome
-uniform bool u_isSky;
-uniform vec3 u_skyTopColor;
-uniform vec3 u_skyBottomColor;
-uniform sampler2D u_skyTex;
+Light fetchLight(int index) {
+    vec4 pos_type = texelFetch(light_data, index * 4);
+    vec4 dir_angle = texelFetch(light_data, index * 4 + 1);
+    vec4 color_penumbra = texelFetch(light_data, index * 4 + 2);
+    vec4 function = texelFetch(light_data, index * 4 + 3);
+
+    Light light;
+    light.type = int(pos_type.w);
+    light.pos = vec4(pos_type.xyz, 1.0);
+    light.dir = vec4(dir_angle.xyz, 0.0);
+    light.angle = dir_angle.w;
+    light.color = vec4(color_penumbra.rgb, 1.0);
+    light.penumbra = color_penumbra.w;
+    light.function = function.xyz;
+    light.shadow = int(function.w);
+    return light;
+}
 
-void main() {
-    vec3 norm = normalize(world_norm);
-    fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+// 3x3 PCF, every tap is already bilinearly filtered by the comparison sampler
+float filterShadow(sampler2DArrayShadow maps, vec4 clip, int layer) {
+    vec3 coord = clip.xyz / clip.w * 0.5 + 0.5;
+    if (coord.z > 1.0) return 1.0;
+    vec2 texel = 1.0 / vec2(textureSize(maps, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            lit += texture(maps, vec4(coord.xy + vec2(x, y) * texel, float(layer), coord.z));
+        }
+    }
+    return lit / 9.0;
+}
 
-    //Skydome
-    if (u_isSky) {
-        // Direction from camera to fragment
-        vec3 dir = normalize(world_pos - camera_pos);
+float directionalShadow(vec3 norm, float view_depth) {
+    if (view_depth > cascade_splits.z) return 1.0;
+    int cascade = view_depth < cascade_splits.x ? 0 : (view_depth < cascade_splits.y ? 1 : 2);
+    // Pushing the lookup out along the normal by about a texel avoids acne without peter-panning
+    vec3 offset = norm * cascade_texels[cascade] * 1.5;
+    return filterShadow(cascade_shadows, cascade_matrices[cascade] * vec4(world_pos + offset, 1.0), cascade);
+}
 
-        // Equirectangular mapping
-        float u = atan(dir.z, dir.x) / (2.0 * 3.14159265) + 0.5;
-        float v = asin(clamp(dir.y, -1.0, 1.0)) / 3.14159265 + 0.5;
-        vec2 uv = vec2(u, v);
+float spotShadow(vec3 norm, int layer, float dist) {
+    vec3 offset = norm * 0.005 * dist;
+    return filterShadow(spot_shadows, spot_matrices[layer] * vec4(world_pos + offset, 1.0), layer);
+}
+
+void main() {
+    velocity = vec4((curr_clip.xy / curr_clip.w - prev_clip.xy / prev_clip.w) * 0.5, 0.0, 1.0);
 
-        vec3 skyColor = texture(u_skyTex, uv).rgb;
+    vec3 norm = normalize(world_norm);
+    fragColor = vec4(0.0, 0.0, 0.0, 1.0);
 
-        fragColor   = vec4(skyColor, 1.0);
-        brightColor = vec4(0.0);  // usually sky shouldn't contribute to bloom
-        return;
+    vec3 albedo = kd * vec3(diffuse);
+    if (texture_layer >= 0) {
+        vec3 texel = texture(material_textures, vec3(uv * texture_repeat, float(texture_layer))).rgb;
+        albedo = mix(albedo, texel, texture_blend);
     }
 
     // Ambient
     vec3 illumination = ka * vec3(ambient);
+    if (env_ambient > 0.0) {
+        illumination += env_ambient * ka * vec3(diffuse) * textureLod(sky_env, norm, env_lod).rgb;
+    }
+
+    // Directional lights reach every froxel, the rest come from this fragment's own list
+    float view_depth = -(view_mat * vec4(world_pos, 1.0)).z;
+    int slice = clamp(int(log(max(view_depth, 1e-4)) * cluster_slicing.x + cluster_slicing.y), 0, cluster_dims.z - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / screen_size * vec2(cluster_dims.xy)), ivec2(0), cluster_dims.xy - 1);
+    uvec2 range = texelFetch(cluster_grid, (slice * cluster_dims.y + tile.y) * cluster_dims.x + tile.x).xy;
 
-    for (int i = 0; i < light_size; i++) {
-        Light light = lights[i];
+    for (int i = 0; i < directional_count + int(range.y); i++) {
+        int index = i < directional_count ? i : int(texelFetch(cluster_lights, int(range.x) + i - directional_count).x);
+        Light light = fetchLight(index);
         float attenuation = 1.0;
         vec3 to_light;
 
         if (light.type == 1) {
             // Negate light direction (light to point) to get it to be point to light
             to_light = normalize(vec3(-light.dir));
+            if (light.shadow >= 0) {
+                attenuation = directionalShadow(norm, view_depth);
+            }
         }
         else if (light.type == 0) {
             // No given direction vector for point lights
@@ -99,6 +175,9 @@ void main() {
             float distance = distance(world_pos, vec3(light.pos));
             attenuation = falloff * min(1, 1/(light.function.x + distance*light.function.y
                                             + distance*distance*light.function.z));
+            if (light.shadow >= 0 && attenuation > 0.0) {
+                attenuation *= spotShadow(norm, light.shadow, distance);
+            }
         }
 
         vec3 reflected_light = reflect(-to_light, norm);
@@ -111,7 +190,7 @@ void main() {
         vec3 specular_term = vec3(0.0);
         if (facing_source > 0.0) {
             specular_term = ks * vec3(specular) * closeness;
-            diffuse_term = kd * vec3(diffuse) * facing_source;
+            diffuse_term = albedo * facing_source;
         }
 
         illumination += attenuation * vec3(light.color) * (diffuse_term + specular_term);
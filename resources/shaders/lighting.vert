@@ -2,18 +2,41 @@
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
+// Per-instance transform for template instances, identity for everything else
+layout (location = 2) in mat4 instance_mat;
+layout (location = 6) in vec2 uv_in;
+// Inverse transpose of instance_mat's upper 3x3, from the instance buffer as well
+layout (location = 7) in mat3 instance_normal_mat;
 
 out vec3 world_pos;
 out vec3 world_norm;
+out vec2 uv;
+// Unjittered positions this frame and last frame, for the velocity buffer
+out vec4 curr_clip;
+out vec4 prev_clip;
 
 uniform mat4 model_mat;
-uniform mat4 view_mat;
-uniform mat4 proj_mat;
+uniform mat3 normal_mat; // Inverse transpose of model_mat
+uniform mat4 mvp_mat;    // view_proj * model_mat, from the CPU
+uniform mat4 view_proj;
+uniform bool instanced;
+uniform mat4 curr_view_proj;
+uniform mat4 prev_view_proj;
+
+// Matches depth.vert so the depth pre-pass and this pass agree bit for bit
+invariant gl_Position;
 
 void main() {
-    world_pos = vec3(model_mat * vec4(position, 1.0));
-    world_norm = normalize(mat3(inverse(transpose(model_mat))) * normal);
+    world_pos = vec3(instance_mat * (model_mat * vec4(position, 1.0)));
+    uv = uv_in;
+    // Inverse transposes compose like the matrices themselves
+    world_norm = normalize(instance_normal_mat * (normal_mat * normal));
+
+    // Same as depth.vert
+    gl_Position = instanced ? view_proj * (instance_mat * (model_mat * vec4(position, 1.0)))
+                            : mvp_mat * vec4(position, 1.0);
 
-    mat4 mvp = proj_mat * view_mat * model_mat;
-    gl_Position = mvp * vec4(position, 1.0);
+    // The scene is static, only the camera moves
+    curr_clip = curr_view_proj * vec4(world_pos, 1.0);
+    prev_clip = prev_view_proj * vec4(world_pos, 1.0);
 }
@@ -0,0 +1,47 @@
+#version 330 core
+
+in vec3 uv;
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
+
+// Premultiplied particle color and bloom contribution, at 1/depth_scale resolution
+uniform sampler2D particles;
+uniform sampler2D particles_bright;
+uniform sampler2D scene_depth;
+uniform int depth_scale;
+// proj[2][2] and proj[3][2], see fire.frag
+uniform vec2 depth_params;
+
+float linearDepth(ivec2 pixel) {
+   float depth = texelFetch(scene_depth, pixel, 0).r;
+   return depth_params.y / (depth * 2.0 - 1.0 + depth_params.x);
+}
+
+void main() {
+   float depth = linearDepth(ivec2(gl_FragCoord.xy));
+   ivec2 low_size = textureSize(particles, 0);
+
+   // Bilateral upsample: the four low resolution texels around this pixel are weighted
+   // bilinearly and by how close the depth they faded against is to ours, so particles
+   // neither bleed over nearer edges nor leave holes behind them
+   vec2 pos = gl_FragCoord.xy / float(depth_scale) - 0.5;
+   ivec2 base = ivec2(floor(pos));
+   vec2 f = pos - vec2(base);
+
+   vec4 color = vec4(0.0);
+   vec4 bright = vec4(0.0);
+   float total = 0.0;
+   for (int i = 0; i < 4; i++) {
+      ivec2 offset = ivec2(i & 1, i >> 1);
+      ivec2 texel = clamp(base + offset, ivec2(0), low_size - 1);
+      vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+      float difference = abs(linearDepth(texel * depth_scale) - depth) / depth;
+      float weight = bilinear.x * bilinear.y / (difference + 1e-3);
+
+      color += texelFetch(particles, texel, 0) * weight;
+      bright += texelFetch(particles_bright, texel, 0) * weight;
+      total += weight;
+   }
+   fragColor = color / max(total, 1e-6);
+   brightColor = bright / max(total, 1e-6);
+}
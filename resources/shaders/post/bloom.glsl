@@ -0,0 +1,7 @@
+// Top of the bloom mip chain
+uniform sampler2D blur;
+uniform float bloomStrength;
+
+vec3 bloomStage(vec3 color, vec2 uvCoord) {
+    return color + texture(blur, uvCoord).rgb * bloomStrength;
+}
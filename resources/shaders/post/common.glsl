@@ -0,0 +1,40 @@
+// Shared by every stage of the fused composite (see PostChain)
+
+float luminance(vec3 c) {
+    return dot(c, vec3(0.299, 0.587, 0.114));
+}
+
+// Set when the scene was rendered below the output resolution
+uniform bool upscale;
+
+// Catmull-Rom upscale of the scene, the 16 taps folded into 5 bilinear fetches
+// (the corners contribute little and are dropped)
+vec3 sceneColor(vec2 uvCoord) {
+    if (!upscale) {
+        return texture(scene, uvCoord).rgb;
+    }
+
+    vec2 size = vec2(textureSize(scene, 0));
+    vec2 p = uvCoord * size;
+    vec2 center = floor(p - 0.5) + 0.5;
+    vec2 f = p - center;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    vec2 uv0 = (center - 1.0) / size;
+    vec2 uv12 = (center + w2 / w12) / size;
+    vec2 uv3 = (center + 2.0) / size;
+
+    vec3 sum = texture(scene, vec2(uv12.x, uv0.y)).rgb * (w12.x * w0.y)
+             + texture(scene, vec2(uv0.x, uv12.y)).rgb * (w0.x * w12.y)
+             + texture(scene, uv12).rgb * (w12.x * w12.y)
+             + texture(scene, vec2(uv3.x, uv12.y)).rgb * (w3.x * w12.y)
+             + texture(scene, vec2(uv12.x, uv3.y)).rgb * (w12.x * w3.y);
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    // The negative lobes can ring below zero around bright HDR edges
+    return max(sum / weight, vec3(0.0));
+}
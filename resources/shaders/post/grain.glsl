@@ -0,0 +1,9 @@
+uniform float grainAmount;
+uniform float grainSeed;
+
+// Animated film grain, stronger in the midtones
+vec3 grainStage(vec3 color, vec2 uvCoord) {
+    float noise = fract(sin(dot(uvCoord * 1000.0 + grainSeed, vec2(12.9898, 78.233))) * 43758.5453) - 0.5;
+    float L = luminance(color);
+    return color + noise * grainAmount * (1.0 - abs(L * 2.0 - 1.0));
+}
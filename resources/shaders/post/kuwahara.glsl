@@ -0,0 +1,27 @@
+// Kuwahara result at reduced resolution, upsampled with the scene as guide
+uniform sampler2D kuwahara;
+
+// Joint bilateral upsample: the four nearest low resolution texels are weighted by distance
+// and by how close their brightness is to the full resolution pixel, so edges stay crisp
+vec3 kuwaharaStage(vec3 color, vec2 uvCoord) {
+    vec2 size = vec2(textureSize(kuwahara, 0));
+    vec2 p = uvCoord * size - 0.5;
+    vec2 base = floor(p);
+    vec2 f = p - base;
+    float guideLum = luminance(color);
+
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int j = 0; j <= 1; ++j) {
+        for (int i = 0; i <= 1; ++i) {
+            vec3 c = texture(kuwahara, (base + vec2(i, j) + 0.5) / size).rgb;
+            float spatial = (i == 0 ? 1.0 - f.x : f.x) * (j == 0 ? 1.0 - f.y : f.y);
+            // Relative difference so the falloff works for HDR values too
+            float d = (luminance(c) - guideLum) / (guideLum + 0.1);
+            float w = spatial * exp(-d * d * 8.0) + 1e-4;
+            sum += c * w;
+            weightSum += w;
+        }
+    }
+    return sum / weightSum;
+}
@@ -0,0 +1,25 @@
+uniform sampler3D lutA;
+uniform sampler3D lutB;
+uniform float lutSizeA;
+uniform float lutSizeB;
+uniform vec3 lutDomainMinA;
+uniform vec3 lutDomainMinB;
+uniform vec3 lutDomainMaxA;
+uniform vec3 lutDomainMaxB;
+uniform float lutBlend; // 0 = lutA only, 1 = lutB only
+
+// Samples texel centers, so the LUT's first and last entries map to its domain's ends
+vec3 sampleLUT(sampler3D lut, float lutSize, vec3 domainMin, vec3 domainMax, vec3 color) {
+    vec3 coord = clamp((color - domainMin) / (domainMax - domainMin), 0.0, 1.0);
+    float scale = (lutSize - 1.0) / lutSize;
+    float offset = 1.0 / (2.0 * lutSize);
+    return texture(lut, scale * coord + offset).rgb;
+}
+
+// Expects tone mapped colors
+vec3 lutStage(vec3 color, vec2 uvCoord) {
+    vec3 a = sampleLUT(lutA, lutSizeA, lutDomainMinA, lutDomainMaxA, color);
+    if (lutBlend <= 0.0) return a;
+    vec3 b = sampleLUT(lutB, lutSizeB, lutDomainMinB, lutDomainMaxB, color);
+    return mix(a, b, lutBlend);
+}
@@ -0,0 +1,6 @@
+uniform float exposure;
+
+// HDR -> [0, 1]
+vec3 tonemapStage(vec3 color, vec2 uvCoord) {
+    return vec3(1.0) - exp(-color * exposure);
+}
@@ -0,0 +1,8 @@
+uniform float vignetteStrength;
+
+// Darkens towards the corners
+vec3 vignetteStage(vec3 color, vec2 uvCoord) {
+    vec2 d = uvCoord - 0.5;
+    float falloff = smoothstep(0.8, 0.2, length(d) * 1.2);
+    return color * mix(1.0, falloff, vignetteStrength);
+}
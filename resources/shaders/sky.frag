@@ -0,0 +1,26 @@
+#version 330 core
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
+layout (location = 2) out vec4 velocity;
+
+in vec2 ndc;
+
+uniform samplerCube u_skyTex;
+// Inverse of the projection times the view rotation, maps a pixel to its view ray
+uniform mat4 inv_view_proj;
+uniform mat4 curr_view_proj;
+uniform mat4 prev_view_proj;
+
+void main() {
+    vec4 ray = inv_view_proj * vec4(ndc, 1.0, 1.0);
+    vec3 dir = normalize(ray.xyz / ray.w);
+
+    fragColor = vec4(texture(u_skyTex, dir).rgb, 1.0);
+    brightColor = vec4(0.0); // Sky doesn't contribute to bloom
+
+    // The sky is infinitely far away, so only camera rotation moves it
+    vec4 curr_clip = curr_view_proj * vec4(dir, 0.0);
+    vec4 prev_clip = prev_view_proj * vec4(dir, 0.0);
+    velocity = vec4((curr_clip.xy / curr_clip.w - prev_clip.xy / prev_clip.w) * 0.5, 0.0, 1.0);
+}
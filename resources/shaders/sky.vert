@@ -0,0 +1,10 @@
+#version 330 core
+
+// One triangle covering the screen, generated from gl_VertexID so no buffer is needed
+out vec2 ndc;
+
+void main() {
+    ndc = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID >> 1) * 4 - 1);
+    // On the far plane, so only pixels no geometry covered pass the depth test
+    gl_Position = vec4(ndc, 1.0, 1.0);
+}
@@ -0,0 +1,86 @@
+#version 330 core
+
+in vec3 uv;
+
+out vec4 fragColor;
+
+// This frame (jittered), its velocity/depth, and last frame's resolved result
+uniform sampler2D current;
+uniform sampler2D velocity;
+uniform sampler2D depth;
+uniform sampler2D history;
+// False on the first frame and after resizes, when there is nothing to reproject
+uniform bool historyValid;
+// How much of the current frame goes into the result
+uniform float feedback;
+
+float luminance(vec3 c) {
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Clamping in YCoCg keeps the box tighter around the actual colors than in RGB
+vec3 rgbToYCoCg(vec3 c) {
+    return vec3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b,
+                0.5 * c.r - 0.5 * c.b,
+                -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+vec3 yCoCgToRgb(vec3 c) {
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+void main()
+{
+    vec2 t = 1.0 / vec2(textureSize(current, 0));
+    vec3 color = texture(current, uv.xy).rgb;
+
+    // Mean and variance of the 3x3 neighborhood, plus the closest sample so edges take the
+    // velocity of the foreground object
+    vec3 m1 = vec3(0.0);
+    vec3 m2 = vec3(0.0);
+    float closest = 1.0;
+    vec2 closestOffset = vec2(0.0);
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            vec2 offset = vec2(x, y) * t;
+            vec3 c = rgbToYCoCg(texture(current, uv.xy + offset).rgb);
+            m1 += c;
+            m2 += c * c;
+
+            float d = texture(depth, uv.xy + offset).r;
+            if (d < closest) {
+                closest = d;
+                closestOffset = offset;
+            }
+        }
+    }
+
+    vec2 previousUV = uv.xy - texture(velocity, uv.xy + closestOffset).xy;
+    if (!historyValid || any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0)))) {
+        fragColor = vec4(color, 1.0);
+        return;
+    }
+
+    // Variance clipping: history outside mean +- 1.25 sigma is pulled back towards the mean
+    vec3 mean = m1 / 9.0;
+    vec3 sigma = sqrt(max(m2 / 9.0 - mean * mean, vec3(0.0)));
+    vec3 boxMin = mean - 1.25 * sigma;
+    vec3 boxMax = mean + 1.25 * sigma;
+
+    vec3 previous = rgbToYCoCg(texture(history, previousUV).rgb);
+    vec3 toPrevious = previous - mean;
+    vec3 extent = max((boxMax - boxMin) * 0.5, vec3(1e-4));
+    vec3 units = abs(toPrevious / extent);
+    float maxUnit = max(units.x, max(units.y, units.z));
+    if (maxUnit > 1.0) {
+        previous = mean + toPrevious / maxUnit;
+    }
+    previous = yCoCgToRgb(previous);
+
+    // Weighting by inverse luminance stops bright HDR samples from dominating (and flickering)
+    float currentWeight = feedback / (1.0 + luminance(color));
+    float previousWeight = (1.0 - feedback) / (1.0 + luminance(previous));
+    vec3 result = (color * currentWeight + previous * previousWeight) / (currentWeight + previousWeight);
+
+    fragColor = vec4(max(result, vec3(0.0)), 1.0);
+}
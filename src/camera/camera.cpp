@@ -45,7 +45,12 @@ glm::mat4 Camera::getPerspectiveMatrix() const {
     scale_mat[1][1] = 1.0f / (far * tan(getHeightAngle()/2.0f));
     scale_mat[2][2] = 1.0f / far;
 
-    return mapping_mat * unhinge_mat * scale_mat;
+    // Shifts the image after the perspective divide: x' = x + jitter.x * w
+    glm::mat4 jitter_mat(1.0f);
+    jitter_mat[3][0] = jitter.x;
+    jitter_mat[3][1] = jitter.y;
+
+    return jitter_mat * mapping_mat * unhinge_mat * scale_mat;
 }
 
 float Camera::getAspectRatio() const {
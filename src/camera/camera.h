@@ -14,6 +14,8 @@ public:
     SceneCameraData camera;
     int width;
     int height;
+    // Sub-pixel offset in NDC added by getPerspectiveMatrix, used by TAA
+    glm::vec2 jitter = glm::vec2(0.f);
 
     // Returns the view matrix for the current camera settings.
     // You might also want to define another function that return the inverse of the view matrix.
@@ -1,6 +1,8 @@
 #include "mainwindow.h"
+#include "settings.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QScreen>
 #include <iostream>
 #include <QSettings>
@@ -12,6 +14,14 @@ int main(int argc, char *argv[]) {
     QCoreApplication::setOrganizationName("CS 1230");
     QCoreApplication::setApplicationVersion(QT_VERSION_STR);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    // e.g. --shader-dir resources/shaders, to iterate on shaders without rebuilding
+    QCommandLineOption shaderDir("shader-dir", "Load shaders from <dir> and reload them when they change.", "dir");
+    parser.addOption(shaderDir);
+    parser.process(a);
+    settings.shaderDir = parser.value(shaderDir).toStdString();
+
     QSurfaceFormat fmt;
     fmt.setVersion(4, 1);
     fmt.setProfile(QSurfaceFormat::CoreProfile);
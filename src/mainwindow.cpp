@@ -57,6 +57,12 @@ void MainWindow::initialize() {
     fogMin_label->setText("Fog Min Distance:");
     QLabel *fogMax_label = new QLabel(); // Fog max distance label
     fogMax_label->setText("Fog Max Distance:");
+    QLabel *kuwahara_label = new QLabel(); // Kuwahara quality label
+    kuwahara_label->setText("Kuwahara Quality:");
+    QLabel *gradeBlend_label = new QLabel(); // Grade blend label
+    gradeBlend_label->setText("Grade Blend:");
+    QLabel *postOrder_label = new QLabel(); // Post-processing order label
+    postOrder_label->setText("Post Order:");
 
 
     // From old Project 6
@@ -220,9 +226,56 @@ void MainWindow::initialize() {
     lexposure->addWidget(exposureBox);
     exposureLayout->setLayout(lexposure);
 
+    // Creates box containing the kuwahara quality slider and number box
+    QGroupBox *kuwaharaLayout = new QGroupBox();
+    QHBoxLayout *lkuwahara = new QHBoxLayout();
+
+    // 1 = quarter resolution, 2 = half, 3 = full
+    kuwaharaSlider = new QSlider(Qt::Orientation::Horizontal);
+    kuwaharaSlider->setTickInterval(1);
+    kuwaharaSlider->setMinimum(1);
+    kuwaharaSlider->setMaximum(3);
+    kuwaharaSlider->setValue(settings.kuwaharaQuality);
+
+    kuwaharaBox = new QSpinBox();
+    kuwaharaBox->setMinimum(1);
+    kuwaharaBox->setMaximum(3);
+    kuwaharaBox->setSingleStep(1);
+    kuwaharaBox->setValue(settings.kuwaharaQuality);
+
+    lkuwahara->addWidget(kuwaharaSlider);
+    lkuwahara->addWidget(kuwaharaBox);
+    kuwaharaLayout->setLayout(lkuwahara);
+
+    // Creates box containing the grade blend slider and number box
+    QGroupBox *gradeBlendLayout = new QGroupBox();
+    QHBoxLayout *lgradeBlend = new QHBoxLayout();
+
+    // 0 = ungraded, 1 = the last LUT, the built-in one unless the scene brings its own
+    gradeBlendSlider = new QSlider(Qt::Orientation::Horizontal);
+    gradeBlendSlider->setTickInterval(1);
+    gradeBlendSlider->setMinimum(0);
+    gradeBlendSlider->setMaximum(100);
+    gradeBlendSlider->setValue(int(settings.gradeBlend * 100.f));
+
+    gradeBlendBox = new QDoubleSpinBox();
+    gradeBlendBox->setDecimals(2);
+    gradeBlendBox->setMinimum(0.0);
+    gradeBlendBox->setMaximum(1.0);
+    gradeBlendBox->setSingleStep(0.01);
+    gradeBlendBox->setValue(settings.gradeBlend);
+
+    lgradeBlend->addWidget(gradeBlendSlider);
+    lgradeBlend->addWidget(gradeBlendBox);
+    gradeBlendLayout->setLayout(lgradeBlend);
+
+    // Names of the post passes, applied in the order listed when editing finishes
+    postOrderEdit = new QLineEdit();
+    postOrderEdit->setText(QString::fromStdString(settings.postOrder));
+
     // Extra Credit:
     ec1 = new QCheckBox();
-    ec1->setText(QStringLiteral("Bloom/Filter"));
+    ec1->setText(QStringLiteral("Bloom"));
     ec1->setChecked(false);
 
     ec2 = new QCheckBox();
@@ -230,13 +283,37 @@ void MainWindow::initialize() {
     ec2->setChecked(false);
 
     ec3 = new QCheckBox();
-    ec3->setText(QStringLiteral("Extra Credit 3"));
+    ec3->setText(QStringLiteral("Kuwahara"));
     ec3->setChecked(false);
 
     ec4 = new QCheckBox();
-    ec4->setText(QStringLiteral("Extra Credit 4"));
+    ec4->setText(QStringLiteral("Vignette/Grain"));
     ec4->setChecked(false);
 
+    dynamicRes = new QCheckBox();
+    dynamicRes->setText(QStringLiteral("Dynamic Resolution"));
+    dynamicRes->setChecked(settings.dynamicResolution);
+
+    taa = new QCheckBox();
+    taa->setText(QStringLiteral("Temporal Anti-Aliasing"));
+    taa->setChecked(settings.taa);
+
+    depthPrepass = new QCheckBox();
+    depthPrepass->setText(QStringLiteral("Depth Pre-pass"));
+    depthPrepass->setChecked(settings.depthPrepass);
+
+    fireLights = new QCheckBox();
+    fireLights->setText(QStringLiteral("Fire Lighting"));
+    fireLights->setChecked(settings.fireLights);
+
+    shadows = new QCheckBox();
+    shadows->setText(QStringLiteral("Shadows"));
+    shadows->setChecked(settings.shadows);
+
+    skyAmbient = new QCheckBox();
+    skyAmbient->setText(QStringLiteral("Sky Ambient"));
+    skyAmbient->setChecked(settings.skyAmbient);
+
     vLayout->addWidget(uploadFile);
     vLayout->addWidget(saveImage);
     vLayout->addWidget(tesselation_label);
@@ -268,8 +345,20 @@ void MainWindow::initialize() {
     vLayout->addWidget(ec_label);
     vLayout->addWidget(ec1);
     vLayout->addWidget(ec2);
+    vLayout->addWidget(gradeBlend_label);
+    vLayout->addWidget(gradeBlendLayout);
     vLayout->addWidget(ec3);
+    vLayout->addWidget(kuwahara_label);
+    vLayout->addWidget(kuwaharaLayout);
     vLayout->addWidget(ec4);
+    vLayout->addWidget(postOrder_label);
+    vLayout->addWidget(postOrderEdit);
+    vLayout->addWidget(dynamicRes);
+    vLayout->addWidget(taa);
+    vLayout->addWidget(depthPrepass);
+    vLayout->addWidget(fireLights);
+    vLayout->addWidget(shadows);
+    vLayout->addWidget(skyAmbient);
 
     connectUIElements();
 
@@ -300,6 +389,9 @@ void MainWindow::connectUIElements() {
     connectFar();
     connectFog();
     connectExposure();
+    connectKuwahara();
+    connectGradeBlend();
+    connectPostOrder();
     connectExtraCredit();
 }
 
@@ -365,11 +457,39 @@ void MainWindow::connectExposure() {
             });
 }
 
+void MainWindow::connectKuwahara() {
+    connect(kuwaharaSlider, &QSlider::valueChanged, this, &MainWindow::onValChangeKuwahara);
+    connect(kuwaharaBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeKuwahara);
+}
+
+void MainWindow::connectGradeBlend() {
+    connect(gradeBlendSlider, &QSlider::valueChanged, this, &MainWindow::onValChangeGradeBlend);
+    connect(gradeBlendBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), [=, this](double d) {
+                gradeBlendSlider->setValue(int(d * 100.0));
+                settings.gradeBlend = d;
+                realtime->settingsChanged();
+            });
+}
+
+void MainWindow::connectPostOrder() {
+    connect(postOrderEdit, &QLineEdit::editingFinished, [=, this]() {
+                settings.postOrder = postOrderEdit->text().toStdString();
+                realtime->settingsChanged();
+            });
+}
+
 void MainWindow::connectExtraCredit() {
     connect(ec1, &QCheckBox::clicked, this, &MainWindow::onBloom);
     connect(ec2, &QCheckBox::clicked, this, &MainWindow::onGraded);
-    connect(ec3, &QCheckBox::clicked, this, &MainWindow::onExtraCredit3);
-    connect(ec4, &QCheckBox::clicked, this, &MainWindow::onExtraCredit4);
+    connect(ec3, &QCheckBox::clicked, this, &MainWindow::onKuwahara);
+    connect(ec4, &QCheckBox::clicked, this, &MainWindow::onVignetteGrain);
+    connect(dynamicRes, &QCheckBox::clicked, this, &MainWindow::onDynamicResolution);
+    connect(taa, &QCheckBox::clicked, this, &MainWindow::onTAA);
+    connect(depthPrepass, &QCheckBox::clicked, this, &MainWindow::onDepthPrepass);
+    connect(fireLights, &QCheckBox::clicked, this, &MainWindow::onFireLights);
+    connect(shadows, &QCheckBox::clicked, this, &MainWindow::onShadows);
+    connect(skyAmbient, &QCheckBox::clicked, this, &MainWindow::onSkyAmbient);
 }
 
 // From old Project 6
@@ -501,6 +621,23 @@ void MainWindow::onValChangeExposure(int newValue) {
     realtime->settingsChanged();
 }
 
+// Kuwahara
+void MainWindow::onValChangeKuwahara(int newValue) {
+    kuwaharaSlider->setValue(newValue);
+    kuwaharaBox->setValue(newValue);
+    settings.kuwaharaQuality = kuwaharaSlider->value();
+    realtime->settingsChanged();
+}
+
+// Grading
+void MainWindow::onValChangeGradeBlend(int newValue) {
+    float realBlend = newValue / 100.0f;
+    gradeBlendSlider->setValue(newValue);
+    gradeBlendBox->setValue(realBlend);
+    settings.gradeBlend = realBlend;
+    realtime->settingsChanged();
+}
+
 // Extra Credit:
 
 void MainWindow::onBloom() {
@@ -513,12 +650,42 @@ void MainWindow::onGraded() {
     realtime->settingsChanged();
 }
 
-void MainWindow::onExtraCredit3() {
-    settings.extraCredit3 = !settings.extraCredit3;
+void MainWindow::onKuwahara() {
+    settings.kuwahara = !settings.kuwahara;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onVignetteGrain() {
+    settings.vignetteGrain = !settings.vignetteGrain;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDynamicResolution() {
+    settings.dynamicResolution = !settings.dynamicResolution;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onTAA() {
+    settings.taa = !settings.taa;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onDepthPrepass() {
+    settings.depthPrepass = !settings.depthPrepass;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onFireLights() {
+    settings.fireLights = !settings.fireLights;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onShadows() {
+    settings.shadows = !settings.shadows;
     realtime->settingsChanged();
 }
 
-void MainWindow::onExtraCredit4() {
-    settings.extraCredit4 = !settings.extraCredit4;
+void MainWindow::onSkyAmbient() {
+    settings.skyAmbient = !settings.skyAmbient;
     realtime->settingsChanged();
 }
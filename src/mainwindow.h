@@ -6,6 +6,7 @@
 #include <QSpinBox>
 #include <QDoubleSpinBox>
 #include <QPushButton>
+#include <QLineEdit>
 #include "realtime.h"
 #include "utils/aspectratiowidget/aspectratiowidget.hpp"
 
@@ -25,6 +26,9 @@ private:
     void connectFar();
     void connectFog();
     void connectExposure();
+    void connectKuwahara();
+    void connectGradeBlend();
+    void connectPostOrder();
 
     // From old Project 6
     // void connectPerPixelFilter();
@@ -62,11 +66,28 @@ private:
     QSlider *exposureSlider;
     QDoubleSpinBox *exposureBox;
 
+    // Kuwahara
+    QSlider *kuwaharaSlider;
+    QSpinBox *kuwaharaBox;
+
+    // Grading
+    QSlider *gradeBlendSlider;
+    QDoubleSpinBox *gradeBlendBox;
+
+    // Post-processing order
+    QLineEdit *postOrderEdit;
+
     // Extra Credit:
     QCheckBox *ec1;
     QCheckBox *ec2;
     QCheckBox *ec3;
     QCheckBox *ec4;
+    QCheckBox *dynamicRes;
+    QCheckBox *taa;
+    QCheckBox *depthPrepass;
+    QCheckBox *fireLights;
+    QCheckBox *shadows;
+    QCheckBox *skyAmbient;
 
 private slots:
     // From old Project 6
@@ -86,10 +107,18 @@ private slots:
     void onValChangeFogMaxSlider(int newValue);
     void onValChangeFogMaxBox(double newValue);
     void onValChangeExposure(int newValue);
+    void onValChangeKuwahara(int newValue);
+    void onValChangeGradeBlend(int newValue);
 
     // Extra Credit:
     void onBloom();
     void onGraded();
-    void onExtraCredit3();
-    void onExtraCredit4();
+    void onKuwahara();
+    void onVignetteGrain();
+    void onDynamicResolution();
+    void onTAA();
+    void onDepthPrepass();
+    void onFireLights();
+    void onShadows();
+    void onSkyAmbient();
 };
@@ -10,9 +10,14 @@
 #include "camera/camera.h"
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
 #include <QMouseEvent>
 #include <QKeyEvent>
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include "settings.h"
 
  #include <glm/gtx/string_cast.hpp>
@@ -42,6 +47,10 @@ void Realtime::finish() {
     killTimer(m_timer);
     this->makeCurrent();
 
+    // Stop uploads before anything they might touch is deleted
+    m_uploader.stop();
+    m_shader_reloader.stop();
+
     // Students: anything requiring OpenGL calls when the program exits should be done here
     glDeleteBuffers(1, &m_vbo_sphere);
     glDeleteVertexArrays(1, &m_vao_sphere);
@@ -55,14 +64,7 @@ void Realtime::finish() {
     glDeleteBuffers(1, &m_vbo_cube);
     glDeleteVertexArrays(1, &m_vao_cube);
 
-    std::vector<RenderShapeData> &shapes = m_renderData.shapes;
-    for (int k = 0; k < shapes.size(); k++) {
-        RenderShapeData& object = shapes[k];
-        if (object.primitive.type == PrimitiveType::PRIMITIVE_MESH) {
-            glDeleteBuffers(1, &object.vbo);
-            glDeleteVertexArrays(1, &object.vao);
-        }
-    }
+    deleteSceneBuffers();
 
     if (m_skyTexture) {
         glDeleteTextures(1, &m_skyTexture);
@@ -72,58 +74,36 @@ void Realtime::finish() {
     glDeleteBuffers(1, &m_fullscreen_vbo);
 
     glDeleteProgram(m_shader);
-    glDeleteProgram(m_shader_bloom);
-    glDeleteProgram(m_shader_blur);
+    glDeleteProgram(m_shader_depth);
+    glDeleteProgram(m_shader_bloom_down);
+    glDeleteProgram(m_shader_bloom_up);
     glDeleteProgram(m_fire_shader);
     glDeleteProgram(m_shader_kuwahara);
-
-    glDeleteTextures(2, m_color_buffers);
-    glDeleteTextures(2, m_pingpong_color);
-    glDeleteRenderbuffers(1, &m_rbo);
-    glDeleteFramebuffers(1, &m_fbo);
-    glDeleteFramebuffers(1, m_pingpong_fbo);
+    glDeleteProgram(m_shader_kuwahara_prep);
+    glDeleteProgram(m_shader_kuwahara_blur);
+    glDeleteProgram(m_shader_taa);
+    glDeleteProgram(m_shader_sky);
+    glDeleteProgram(m_shader_particle_composite);
+    if (m_shader_kuwahara_compute) {
+        glDeleteProgram(m_shader_kuwahara_compute);
+    }
+    m_post_chain.destroy();
+    m_graph.destroy();
+    m_resolution.destroy();
+    m_light_clusters.destroy();
+    m_shadows.destroy();
+    m_textures.destroy();
+    for (ColorLUT::Texture &lut : m_luts) {
+        glDeleteTextures(1, &lut.texture);
+    }
+    m_luts.clear();
+    glDeleteTextures(2, m_taa_history);
 
     this->doneCurrent();
 }
 
-
-void insertVec3(std::vector<float> &data, glm::vec3 v) {
-    data.push_back(v.x);
-    data.push_back(v.y);
-    data.push_back(v.z);
-}
-
-void Realtime::makeCircleTile(glm::vec3 bottomRight, glm::vec3 top, glm::vec3 bottomLeft) {
-    insertVec3(m_vertexData, bottomLeft);
-    insertVec3(m_vertexData, top);
-    insertVec3(m_vertexData, bottomRight);
-}
-
-void Realtime::makeCircleSlice(float currentTheta, float nextTheta, float z) {
-    if (m_radius <= 0.f) return; // nothing to draw
-
-    glm::vec3 center     = {0.f, 0.f, z};
-    glm::vec3 edge1      = {m_radius * cos(currentTheta), m_radius * sin(currentTheta), z};
-    glm::vec3 edge2      = {m_radius * cos(nextTheta),    m_radius * sin(nextTheta),    z};
-
-    // One triangle: center, edge1, edge2
-    makeCircleTile(edge1, center, edge2);
-}
-
-
-void Realtime::createCircle(float tessalations, float z) {
-    float step_size = (2*M_PI)/tessalations;
-    for (int i = 0; i<tessalations; ++i) {
-        float currentTheta = i*step_size;
-        float nextTheta = (i+1)*step_size;
-        makeCircleSlice(currentTheta, nextTheta, z);
-    }
-}
-
-
 void Realtime::initializeGL() {
     m_devicePixelRatio = this->devicePixelRatio();
-    m_default_fbo = 2;
     m_screen_width = size().width() * m_devicePixelRatio;
     m_screen_height = size().height() * m_devicePixelRatio;
     m_fbo_width = m_screen_width;
@@ -145,30 +125,49 @@ void Realtime::initializeGL() {
     glEnable(GL_DEPTH_TEST);
     // Tells OpenGL to only draw the front face
     glEnable(GL_CULL_FACE);
+    // Filters across cubemap face edges, which matters most for the small sky mips
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
     // Tells OpenGL how big the screen is
     glViewport(0, 0, size().width() * m_devicePixelRatio, size().height() * m_devicePixelRatio);
 
     // Clear color (may need to change)
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-    // Shader setup
-    m_shader = ShaderLoader::createShaderProgram(":/resources/shaders/lighting.vert", ":/resources/shaders/lighting.frag");
-    m_shader_bloom = ShaderLoader::createShaderProgram(":/resources/shaders/bloom.vert", ":/resources/shaders/bloom.frag");
-    m_shader_blur = ShaderLoader::createShaderProgram(":/resources/shaders/blur.vert", ":/resources/shaders/blur.frag");
-    m_fire_shader = ShaderLoader::createShaderProgram(":/resources/shaders/fire.vert", ":/resources/shaders/fire.frag");
-    m_shader_kuwahara = ShaderLoader::createShaderProgram(":/resources/shaders/kuwahara.vert", ":/resources/shaders/kuwahara.frag");
+    // Large meshes and textures are uploaded from a second context sharing with ours
+    m_uploader.start(context());
+
+    // Shader setup, read from disk and rebuilt on edits in dev mode (--shader-dir)
+    if (!settings.shaderDir.empty()) {
+        m_shader_reloader.start(QString::fromStdString(settings.shaderDir));
+        // The composites are built on demand, the post chain rebuilds them itself
+        m_shader_reloader.onSourcesChanged = [this] { m_post_chain.reload(); };
+    }
+    m_shader_reloader.create(&m_shader, ":/resources/shaders/lighting.vert", ":/resources/shaders/lighting.frag");
+    m_shader_reloader.create(&m_shader_depth, ":/resources/shaders/depth.vert", ":/resources/shaders/depth.frag");
+    m_shader_reloader.create(&m_shader_bloom_down, ":/resources/shaders/bloom.vert", ":/resources/shaders/bloom_down.frag");
+    m_shader_reloader.create(&m_shader_bloom_up, ":/resources/shaders/bloom.vert", ":/resources/shaders/bloom_up.frag");
+    m_shader_reloader.create(&m_fire_shader, ":/resources/shaders/fire.vert", ":/resources/shaders/fire.frag");
+    m_shader_reloader.create(&m_shader_particle_composite, ":/resources/shaders/bloom.vert", ":/resources/shaders/particles_composite.frag");
+    m_shader_reloader.create(&m_shader_kuwahara, ":/resources/shaders/kuwahara.vert", ":/resources/shaders/kuwahara.frag");
+    m_shader_reloader.create(&m_shader_kuwahara_prep, ":/resources/shaders/kuwahara.vert", ":/resources/shaders/kuwahara_prep.frag");
+    m_shader_reloader.create(&m_shader_kuwahara_blur, ":/resources/shaders/kuwahara.vert", ":/resources/shaders/kuwahara_tensor_blur.frag");
+    m_shader_reloader.create(&m_shader_taa, ":/resources/shaders/bloom.vert", ":/resources/shaders/taa.frag");
+    m_shader_reloader.create(&m_shader_sky, ":/resources/shaders/sky.vert", ":/resources/shaders/sky.frag");
+    // The tiled compute version needs GL 4.3, the fragment shader above is the fallback
+    if (GLEW_VERSION_4_3) {
+        try {
+            m_shader_reloader.createCompute(&m_shader_kuwahara_compute, ":/resources/shaders/kuwahara.comp");
+        } catch (const std::runtime_error &e) {
+            std::cerr << "[Kuwahara] Compute shader unavailable, using the fragment shader: " << e.what() << std::endl;
+        }
+    }
 
     createUniforms();
 
     //Skydome
-    Sphere skySphere;
-    // Reasonable tessellation – doesn’t need to match main spheres
-    skySphere.updateParams(40, 40);
-    fillVertices(skySphere, m_vbo_sky, m_vao_sky, num_sky_verts);
     initSkydome();
 
     //fire
-    createCircle(m_tessalations, -0.f);
     //instance particles
     for(int i = -m_rows; i<m_rows;++i) {
         for(int j = -m_cols; j<m_cols;++j) {
@@ -202,20 +201,13 @@ void Realtime::initializeGL() {
     glBufferData(GL_ARRAY_BUFFER, 50000*3*sizeof(GLfloat), NULL, GL_STREAM_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, m_color_data.size()*sizeof(GLfloat), m_color_data.data());
 
-    //generate vao
-    glGenBuffers(GLuint(1.f), &m_fire_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_fire_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*m_vertexData.size(), m_vertexData.data(), GL_STATIC_DRAW);
-    //fire vao
+    //fire vao, the billboard corners are generated from gl_VertexID
     glGenVertexArrays(GLuint(1.f), &m_fire_vao);
     glBindVertexArray(m_fire_vao);
     //fire vao attributes
-    glEnableVertexAttribArray(0); //position
     glEnableVertexAttribArray(1); //offsets
     glEnableVertexAttribArray(2); //color
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_fire_vbo);
-    glVertexAttribPointer(0, 3.f, GL_FLOAT, GL_FALSE,3*sizeof(GLfloat),reinterpret_cast<void*>(0)); //position
     glBindBuffer(GL_ARRAY_BUFFER, m_pos_vbo);
     glVertexAttribPointer(1, 3.f, GL_FLOAT, GL_FALSE,0,reinterpret_cast<void*>(0)); //offsets
     glBindBuffer(GL_ARRAY_BUFFER, m_color_vbo);
@@ -226,8 +218,13 @@ void Realtime::initializeGL() {
     glBindVertexArray(0);
 
     makeFullscreenQuad();
-    makeBloomFBO();
-    loadLUT();
+    makeTAAHistory();
+    m_resolution.init();
+    m_light_clusters.init();
+    m_shadows.init();
+    m_textures.init();
+    loadLUTs();
+    makePostChain();
 
     initialized = true;
 }
@@ -236,6 +233,102 @@ bool checkOverlap(glm::vec2 c1, glm::vec2 c2, float r1, float r2) {
     return fabs((c1.x-c2.x)*(c1.x-c2.x) + (c1.y-c2.y)*(c1.y-c2.y)) <= (r1+r2)*(r1+r2);
 }
 
+glm::vec3 heatColor(float h) {
+    h = glm::clamp(h, 0.f, 1.f);
+    glm::vec3 color;
+
+    if(!settings.graded) {
+        if(h < 0.33) {
+            float t = h/0.33;
+            color = glm::mix(glm::vec3{0,0,0}, glm::vec3{1,0,0}, t); //mix black -> red
+        }
+        else if (h < 0.66) {
+            float t = (h-0.33)/0.33f;
+            color = glm::mix(glm::vec3{1,0,0}, glm::vec3{1,0.5,0}, t); //red -> orange
+        } else {
+            float t = (h - 0.66)/0.34f;
+            color = glm::mix(glm::vec3{1,0.5,0}, glm::vec3{1,0.9,0}, t); //orange -> almost yellow
+        }
+    }
+    else {
+        if (h < 0.25f) {
+            float t = h / 0.25f;
+            color = glm::mix(glm::vec3(0,0,0), glm::vec3(0,0,1), t);  // black → blue
+        }
+        else if (h < 0.50f) {
+            float t = (h - 0.25f) / 0.25f;
+            color = glm::mix(glm::vec3(0,0,1), glm::vec3(0,1,1), t);  // blue → cyan
+        }
+        else if (h < 0.75f) {
+            float t = (h - 0.50f) / 0.25f;
+            color = glm::mix(glm::vec3(0,1,1), glm::vec3(0,1,0), t);  // cyan → green
+        }
+        else {
+            float t = (h - 0.75f) / 0.25f;
+            color = glm::mix(glm::vec3(0,1,0), glm::vec3(1,0,0), t);  // green → red
+        }
+    }
+    return color;
+}
+
+void Realtime::updateFireLights(const glm::mat4 &view) {
+    m_fire_lights.clear();
+    if (!settings.fireLights || m_particles.empty()) return;
+
+    // Hot particles are binned into a coarse grid over the fire's bounds; every cell summarizes
+    // its particles as one candidate light and the hottest cells become point lights.
+    // At most MAX_SAMPLES particles are looked at, however many there are.
+    const int MAX_SAMPLES = 4096;
+    int cells = m_fire_light_cols * m_fire_light_rows;
+    std::vector<glm::vec3> sums(cells, glm::vec3(0.f)); // Heat weighted x, y and total heat
+    std::vector<int> counts(cells, 0);
+    int stride = std::max(1, int(m_particles.size()) / MAX_SAMPLES);
+    int sampled = 0;
+    for (int a = 0; a < m_particles.size(); a += stride) {
+        sampled++;
+        float heat = glm::clamp(m_particles[a].heat, 0.f, 1.f);
+        if (heat < m_fire_light_min_heat) continue;
+
+        float x = m_pos_data[3*a + 0], y = m_pos_data[3*a + 1];
+        int col = glm::clamp(int((x + m_side_bound) / (2.f * m_side_bound) * m_fire_light_cols), 0, m_fire_light_cols - 1);
+        int row = glm::clamp(int((y + m_ground_bound) / m_fire_light_height * m_fire_light_rows), 0, m_fire_light_rows - 1);
+        int cell = row * m_fire_light_cols + col;
+        sums[cell] += glm::vec3(x * heat, y * heat, heat);
+        counts[cell]++;
+    }
+
+    // Each cell's share of the fire's heat, smoothed so lights flicker instead of popping
+    m_fire_cell_heat.resize(cells, 0.f);
+    std::vector<int> order(cells);
+    for (int i = 0; i < cells; i++) {
+        m_fire_cell_heat[i] = glm::mix(m_fire_cell_heat[i], sums[i].z / std::max(sampled, 1), 0.3f);
+        order[i] = i;
+    }
+    int count = std::min(m_fire_light_count, cells);
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](int a, int b) {
+        return m_fire_cell_heat[a] > m_fire_cell_heat[b];
+    });
+
+    // The fire is drawn as a camera facing sheet, so particle x/y run along the camera's right/up
+    glm::vec3 right(view[0][0], view[1][0], view[2][0]);
+    glm::vec3 up(view[0][1], view[1][1], view[2][1]);
+    for (int i = 0; i < count; i++) {
+        int cell = order[i];
+        if (!counts[cell] || m_fire_cell_heat[cell] < 0.001f) continue;
+
+        glm::vec2 center = glm::vec2(sums[cell]) / sums[cell].z;
+        glm::vec3 color = heatColor(sums[cell].z / counts[cell]) * m_fire_light_intensity * m_fire_cell_heat[cell];
+
+        SceneLightData light = {};
+        light.id = -1;
+        light.type = LightType::LIGHT_POINT;
+        light.pos = glm::vec4(right * center.x + up * center.y, 1.f);
+        light.color = glm::vec4(color, 1.f);
+        light.function = glm::vec3(1.f, 0.5f, 1.5f);
+        m_fire_lights.push_back(light);
+    }
+}
+
 void Realtime::fireLoop() {
     //movement + gravity
     for(int a = 0; a<m_particles.size(); ++a) {
@@ -269,41 +362,7 @@ void Realtime::fireLoop() {
                 m_particles[a].heat = h;
             }
 
-            h = glm::clamp(h, 0.f, 1.f);
-            glm::vec3 color;
-
-            if(!settings.graded) {
-                if(h < 0.33) {
-                    float t = h/0.33;
-                    color = glm::mix(glm::vec3{0,0,0}, glm::vec3{1,0,0}, t); //mix black -> red
-                }
-                else if (h < 0.66) {
-                    float t = (h-0.33)/0.33f;
-                    color = glm::mix(glm::vec3{1,0,0}, glm::vec3{1,0.5,0}, t); //red -> orange
-                } else {
-                    float t = (h - 0.66)/0.34f;
-                    color = glm::mix(glm::vec3{1,0.5,0}, glm::vec3{1,0.9,0}, t); //orange -> almost yellow
-                }
-            }
-            else {
-                if (h < 0.25f) {
-                    float t = h / 0.25f;
-                    color = glm::mix(glm::vec3(0,0,0), glm::vec3(0,0,1), t);  // black → blue
-                }
-                else if (h < 0.50f) {
-                    float t = (h - 0.25f) / 0.25f;
-                    color = glm::mix(glm::vec3(0,0,1), glm::vec3(0,1,1), t);  // blue → cyan
-                }
-                else if (h < 0.75f) {
-                    float t = (h - 0.50f) / 0.25f;
-                    color = glm::mix(glm::vec3(0,1,1), glm::vec3(0,1,0), t);  // cyan → green
-                }
-                else {
-                    float t = (h - 0.75f) / 0.25f;
-                    color = glm::mix(glm::vec3(0,1,0), glm::vec3(1,0,0), t);  // green → red
-                }
-            }
-
+            glm::vec3 color = heatColor(h);
 
             m_color_data[index1 + 0] = color.r;
             m_color_data[index1 + 1] = color.g;
@@ -403,272 +462,662 @@ void Realtime::fireLoop() {
 }
 
 void Realtime::initSkydome(){
-    QImage img("/Users/skylerhall/Desktop/cs1230/proj-flameon/src/rogland_clear_night_2k.jpeg");
-    if (img.isNull()) {
-        std::cerr << "[Skydome] Failed to load sky texture image\n";
-        m_skyTexture = 0;
-        return;
+    // A sky image next to the scene file replaces the built-in one
+    QString source = ":/src/rogland_clear_night_2k.jpeg";
+    if (!settings.sceneFilePath.empty()) {
+        QDir dir = QFileInfo(QString::fromStdString(settings.sceneFilePath)).dir();
+        for (const char *name : {"sky.jpg", "sky.jpeg", "sky.png"}) {
+            if (dir.exists(name)) {
+                source = dir.filePath(name);
+                break;
+            }
+        }
     }
+    if (source == m_sky_source) return;
+    m_sky_source = source;
 
-    QImage glImg = img.convertToFormat(QImage::Format_RGBA8888).mirrored();
+    // Converted to a cubemap (or read from the cache) and uploaded in the background,
+    // picked up in collectUploads(). The old sky stays until then.
+    m_sky_upload = m_uploader.uploadCubemap(source);
+}
 
-    glGenTextures(1, &m_skyTexture);
-    glBindTexture(GL_TEXTURE_2D, m_skyTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                 glImg.width(), glImg.height(),
-                 0, GL_RGBA, GL_UNSIGNED_BYTE, glImg.bits());
+void Realtime::collectUploads() {
+    for (GLUploader::Upload &upload : m_uploader.collect()) {
+        if (upload.id == m_sky_upload) {
+            m_sky_upload = -1;
+            if (!upload.name) {
+                std::cerr << "[Skydome] Failed to load sky texture image\n";
+                continue;
+            }
+            if (m_skyTexture) {
+                glDeleteTextures(1, &m_skyTexture);
+            }
+            m_skyTexture = upload.name;
+            m_sky_size = upload.width;
+            std::cout << "[Skydome] Loaded sky cubemap " << m_skyTexture
+                      << " (" << upload.width << "x" << upload.height << " per face)\n";
+            continue;
+        }
+        // A sky that was replaced before it arrived
+        if (upload.type != GLUploader::UploadType::UPLOAD_BUFFER) {
+            glDeleteTextures(1, &upload.name);
+            continue;
+        }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // Meshes from a scene that has since been replaced are simply dropped
+        auto pending = m_pending_meshes.find(upload.id);
+        if (pending == m_pending_meshes.end()) {
+            glDeleteBuffers(1, &upload.name);
+            continue;
+        }
+        RenderShapeData &object = *pending->second;
+        m_pending_meshes.erase(pending);
+
+        // VAOs aren't shared between contexts so they're made here
+        object.vbo = upload.name;
+        object.num_verts = upload.size / 8;
+        makeVAO(object.vbo, object.vao);
+        m_geometry_version++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
 
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+void Realtime::drawSky(const glm::mat4 &view, const glm::mat4 &proj) {
+    // Drawn after the opaque pass at the far plane, so covered pixels are never shaded
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
 
-    std::cout << "[Skydome] Loaded sky texture " << m_skyTexture
-              << " (" << glImg.width() << "x" << glImg.height() << ")\n";
+    glUseProgram(m_shader_sky);
+    // Only the rotation, the sky doesn't move with the camera
+    glm::mat4 inv_view_proj = glm::inverse(proj * glm::mat4(glm::mat3(view)));
+    glUniformMatrix4fv(m_u_sky.inv_view_proj, 1, GL_FALSE, &inv_view_proj[0][0]);
+    glUniformMatrix4fv(m_u_sky.curr_view_proj, 1, GL_FALSE, &m_view_proj[0][0]);
+    glUniformMatrix4fv(m_u_sky.prev_view_proj, 1, GL_FALSE, &m_prev_view_proj[0][0]);
 
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_skyTexture);
+
+    // The vertices come from gl_VertexID, any vao will do
+    glBindVertexArray(m_fullscreen_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
 }
 
-void Realtime::drawSkydome(glm::vec3 camera_pos){
-    glDepthMask(GL_FALSE);
-    // See inside the sphere
-    glDisable(GL_CULL_FACE);
+void Realtime::paintGL() {
+    if (!settings.dynamicResolution && m_resolution.scale() != 1.f) {
+        m_resolution.reset();
+    }
 
-    // Tell shader this is sky
-    glUniform1i(is_sky_ID, 1);
+    // Edited shaders are swapped in between frames, with their uniforms looked up again
+    if (m_shader_reloader.poll()) {
+        createUniforms();
+    }
 
-    // Center dome on camera in world space
-    float radius = 99.f; // large enough vs. your scene scale
-    glm::mat4 model_sky =
-        glm::translate(camera_pos) *
-        glm::scale(glm::vec3(radius));
+    m_resolution.beginFrame();
+    // Qt may hand us a different framebuffer after a resize
+    renderFrame(defaultFramebufferObject(), m_screen_width, m_screen_height,
+                settings.dynamicResolution ? m_resolution.scale() : 1.f);
+    m_resolution.endFrame();
+}
 
-    glUniformMatrix4fv(model_ID, 1, GL_FALSE, &model_sky[0][0]);
+// Low discrepancy sequence in [0, 1), used for the TAA jitter
+float halton(int index, int base) {
+    float result = 0.f;
+    float f = 1.f;
+    while (index > 0) {
+        f /= base;
+        result += f * (index % base);
+        index /= base;
+    }
+    return result;
+}
 
-    // Optional: set sky colors
-    GLint skyTop_ID    = glGetUniformLocation(m_shader, "u_skyTopColor");
-    GLint skyBottom_ID = glGetUniformLocation(m_shader, "u_skyBottomColor");
-    //glUniform3f(skyTop_ID,    0.05f, 0.1f, 0.4f); // dark-ish blue
-    glUniform3f(skyTop_ID,    1.0f, 1.0f, 1.0f); // dark-ish blue
-    glUniform3f(skyBottom_ID, 0.6f,  0.8f, 1.0f); // horizon
+void Realtime::renderFrame(GLuint target, int width, int height, float scale) {
+    collectUploads();
+    m_textures.beginFrame();
+
+    // Everything up to the composite runs at the scene resolution, which then upscales into target
+    m_fbo_width = std::max(int(width * scale), 1);
+    m_fbo_height = std::max(int(height * scale), 1);
+    m_graph.beginFrame(m_fbo_width, m_fbo_height);
+    m_graph.importFramebuffer("output", target, width, height);
+
+    m_camera.jitter = glm::vec2(0.f);
+    m_view_proj = m_camera.getPerspectiveMatrix() * m_camera.getViewMatrix();
+    if (m_taa_last_frame != m_frame - 1) {
+        // Nothing to compare against, so report no motion
+        m_prev_view_proj = m_view_proj;
+    }
+    if (settings.taa) {
+        // Cycles through 8 sub-pixel offsets of the scene targets
+        int index = m_frame % 8 + 1;
+        glm::vec2 offset(halton(index, 2) - 0.5f, halton(index, 3) - 0.5f);
+        m_camera.jitter = offset * 2.f / glm::vec2(m_fbo_width, m_fbo_height);
+    }
 
-    glBindVertexArray(m_vao_sky);
-    glDrawArrays(GL_TRIANGLES, 0, num_sky_verts);
-    glBindVertexArray(0);
+    // Normal and bright colors are written together, the bright ones only feed bloom
+    m_graph.createTexture("scene", GL_RGBA16F, m_fbo_width, m_fbo_height);
+    m_graph.createTexture("bright", GL_RGBA16F, m_fbo_width, m_fbo_height);
+    m_graph.createTexture("velocity", GL_RG16F, m_fbo_width, m_fbo_height);
+    m_graph.createTexture("depth", GL_DEPTH24_STENCIL8, m_fbo_width, m_fbo_height);
+    // Last frame's particles light the scene, fireLoop only runs once they are drawn
+    updateFireLights(m_camera.getViewMatrix());
+    m_frame_lights = m_renderData.lights;
+    m_frame_lights.insert(m_frame_lights.end(), m_fire_lights.begin(), m_fire_lights.end());
+
+    std::vector<std::string> scene_inputs;
+    if (settings.shadows) {
+        // The maps persist across frames, the pass only redraws the layers that went stale
+        m_graph.importTexture("shadow_maps", m_shadows.cascadeTexture(), GL_DEPTH_COMPONENT24,
+                              ShadowMaps::CASCADE_SIZE, ShadowMaps::CASCADE_SIZE);
+        m_graph.addPass("shadows", {}, {"shadow_maps"}, [this](RenderGraph &) {
+            m_shadows.update(m_frame_lights, m_camera.getViewMatrix(), std::max(settings.nearPlane, 0.001f),
+                             settings.farPlane, m_camera.getHeightAngle(), m_camera.getAspectRatio(),
+                             m_geometry_version, [this](const glm::mat4 &view, const glm::mat4 &proj) {
+                drawShadowCasters(view, proj);
+            });
+        }, false);
+        scene_inputs.push_back("shadow_maps");
+    }
 
-    // Reset state
-    glUniform1i(is_sky_ID, 0);
-    glDepthMask(GL_TRUE);
-    glEnable(GL_CULL_FACE);
+    m_graph.addPass("scene", scene_inputs, {"scene", "bright", "velocity", "depth"}, [this](RenderGraph &) {
+        drawScene();
+    });
+    declareParticles(m_graph);
+
+    // TAA runs first so every later pass sees the antialiased image
+    std::string color = "scene";
+    if (settings.taa) {
+        declareTAA(m_graph);
+        color = "taa";
+    }
+
+    if (settings.postOrder != m_post_order) {
+        m_post_order = settings.postOrder;
+        std::vector<std::string> names;
+        for (const QString &name : QString::fromStdString(m_post_order).split(',', Qt::SkipEmptyParts)) {
+            names.push_back(name.trimmed().toStdString());
+        }
+        m_post_chain.setOrder(names);
+
+        std::string applied;
+        for (const std::string &name : m_post_chain.order()) {
+            applied += (applied.empty() ? "" : ", ") + name;
+        }
+        std::cout << "[PostChain] Order: " << applied << std::endl;
+    }
+    m_post_chain.declare(m_graph, color, "output", m_fullscreen_vao);
+    m_graph.execute();
+
+    m_camera.jitter = glm::vec2(0.f);
+    m_prev_view_proj = m_view_proj;
+    m_frame++;
 }
 
-void Realtime::paintGL() {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glViewport(0, 0, m_fbo_width, m_fbo_height);
+void Realtime::drawScene() {
+    glEnable(GL_DEPTH_TEST);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glm::mat4 view_mat = m_camera.getViewMatrix();
 
     glm::mat4 proj_mat = m_camera.getPerspectiveMatrix();
 
+    sortDrawList(view_mat);
+
+    // Nothing drawn before the templates is instanced
+    setIdentityInstance();
+
+    if (settings.depthPrepass) {
+        // Lay down depth first, so the shading pass below lights every pixel exactly once
+        glUseProgram(m_shader_depth);
+        m_draw_view_proj = proj_mat * view_mat;
+        glUniformMatrix4fv(m_u_depth.view_proj, 1, GL_FALSE, &m_draw_view_proj[0][0]);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (const DrawItem &item : m_draw_list) {
+            drawShape(*item.object, item.instance_vbo, item.instances, true);
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
     glUseProgram(m_shader);
 
-    // Need view, proj, and model in shader for mvp matrix
-    glUniformMatrix4fv(view_ID, 1, GL_FALSE, &view_mat[0][0]);
+    // The mvp of each object is built from this in drawShape
+    m_draw_view_proj = proj_mat * view_mat;
+    glUniformMatrix4fv(m_u_lighting.view_mat, 1, GL_FALSE, &view_mat[0][0]);
+    glUniformMatrix4fv(m_u_lighting.view_proj, 1, GL_FALSE, &m_draw_view_proj[0][0]);
 
     glm::vec3 camera_pos = glm::vec3(glm::inverse(view_mat)[3]);
-    glUniform3f(camera_ID, camera_pos.x, camera_pos.y, camera_pos.z);
+    glUniform3f(m_u_lighting.camera_pos, camera_pos.x, camera_pos.y, camera_pos.z);
 
-    //glm::mat4 proj_mat = m_camera.getPerspectiveMatrix();
-    glUniformMatrix4fv(proj_ID, 1, GL_FALSE, &proj_mat[0][0]);
+    glUniformMatrix4fv(m_u_lighting.curr_view_proj, 1, GL_FALSE, &m_view_proj[0][0]);
+    glUniformMatrix4fv(m_u_lighting.prev_view_proj, 1, GL_FALSE, &m_prev_view_proj[0][0]);
+
+    // Lights are binned once per frame instead of being set for every shape
+    static const std::vector<int> no_shadows;
+    m_light_clusters.update(m_frame_lights, settings.shadows ? m_shadows.layers() : no_shadows,
+                            view_mat, std::max(settings.nearPlane, 0.001f), settings.farPlane,
+                            m_camera.getHeightAngle(), m_camera.getAspectRatio());
+    m_light_clusters.bind(4);
+    m_shadows.bind(7);
+    glUniform2f(m_u_lighting.screen_size, m_fbo_width, m_fbo_height);
 
 
     // Phong Id's
     SceneGlobalData global = m_renderData.globalData;
-    glUniform1f(ambient_k_ID, global.ka);
-    glUniform1f(diffuse_k_ID, global.kd);
-    glUniform1f(specular_k_ID, global.ks);
+    glUniform1f(m_u_lighting.ka, global.ka);
+
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textures.texture());
+    glActiveTexture(GL_TEXTURE0);
+
+    // Ambient from a low mip of the sky, which is close to its irradiance
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_skyTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1f(m_u_lighting.env_ambient, settings.skyAmbient && m_skyTexture ? 1.f : 0.f);
+    glUniform1f(m_u_lighting.env_lod, std::max(std::log2(float(std::max(m_sky_size, 1))) - 2.f, 0.f));
+    glUniform1f(m_u_lighting.kd, global.kd);
+    glUniform1f(m_u_lighting.ks, global.ks);
 
     // Fog uniforms
-    glUniform1f(min_fog_ID, settings.fogMin);
-    glUniform1f(max_fog_ID, settings.fogMax);
+    glUniform1f(m_u_lighting.min_dist, settings.fogMin);
+    glUniform1f(m_u_lighting.max_dist, settings.fogMax);
     if(m_parsed)
     m_fog+=m_fog_rate;
 
-    // Binding sky texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_skyTexture);
-    GLint skyTexLoc = glGetUniformLocation(m_shader, "u_skyTex");
-    glUniform1i(skyTexLoc, 0);
-    drawSkydome(camera_pos);
+    if (settings.depthPrepass) {
+        // Depth is final already, only the visible surface of each pixel passes
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+    for (const DrawItem &item : m_draw_list) {
+        drawShape(*item.object, item.instance_vbo, item.instances);
+    }
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 
-    std::vector<RenderShapeData> &object_list = m_renderData.shapes;
-    for (int k = 0; k < object_list.size(); k++) {
-        RenderShapeData& object = object_list[k];
+    drawSky(view_mat, proj_mat);
 
-        glUniformMatrix4fv(model_ID, 1, GL_FALSE, &object.ctm[0][0]);
+    glUseProgram(0);
+}
 
-        phongIllumination(object);
+void Realtime::declareParticles(RenderGraph &graph) {
+    int width = std::max(m_fbo_width / m_particle_downscale, 1);
+    int height = std::max(m_fbo_height / m_particle_downscale, 1);
+    graph.createTexture("particles", GL_RGBA16F, width, height);
+    graph.createTexture("particles_bright", GL_RGBA16F, width, height);
 
-        // After all shaders are setup can actually draw the objects
-        if (object.primitive.type == PrimitiveType::PRIMITIVE_SPHERE) {
-            glBindVertexArray(m_vao_sphere);
-            glDrawArrays(GL_TRIANGLES, 0, num_sphere_verts);
-        }
-        else if (object.primitive.type == PrimitiveType::PRIMITIVE_CYLINDER) {
-            glBindVertexArray(m_vao_cyl);
-            glDrawArrays(GL_TRIANGLES, 0, num_cyl_verts);
-        }
-        else if (object.primitive.type == PrimitiveType::PRIMITIVE_CONE) {
-            glBindVertexArray(m_vao_cone);
-            glDrawArrays(GL_TRIANGLES, 0, num_cone_verts);
-        }
-        else if (object.primitive.type == PrimitiveType::PRIMITIVE_CUBE) {
-            glBindVertexArray(m_vao_cube);
-            glDrawArrays(GL_TRIANGLES, 0, num_cube_verts);
-        }
-        else if (object.primitive.type == PrimitiveType::PRIMITIVE_MESH) {
-            glBindVertexArray(object.vao);
-            glDrawArrays(GL_TRIANGLES, 0, object.num_verts);
+    graph.addPass("particles", {"depth"}, {"particles", "particles_bright"}, [this](RenderGraph &graph) {
+        drawParticles(graph);
+    });
+
+    // Blended over the scene before TAA and bloom read it. Velocity keeps the surface behind,
+    // which only differs from the particles' own camera motion by their depth.
+    graph.addPass("particles_composite", {"particles", "particles_bright", "depth"}, {"scene", "bright"}, [this](RenderGraph &graph) {
+        glm::mat4 proj_mat = m_camera.getPerspectiveMatrix();
+
+        glUseProgram(m_shader_particle_composite);
+        glBindVertexArray(m_fullscreen_vao);
+        // Bound in the order of the samplers set in createUniforms
+        const char *resources[3] = {"particles", "particles_bright", "depth"};
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(resources[i]));
         }
-    }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+        glUniform1i(m_u_particle_composite.depth_scale, m_particle_downscale);
+        glUniform2f(m_u_particle_composite.depth_params, proj_mat[2][2], proj_mat[3][2]);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glUseProgram(m_fire_shader);
-    glBindVertexArray(m_fire_vao);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glDisable(GL_BLEND);
 
-    glm::mat4 model = glm::mat4{1.f};
+        glBindVertexArray(0);
+        glUseProgram(0);
+        glActiveTexture(GL_TEXTURE0);
+    });
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(m_fire_shader, "view_mat"), 1, GL_FALSE, &view_mat[0][0]);
+void Realtime::drawParticles(RenderGraph &graph) {
+    // No depth target, every fragment is tested and faded against the scene depth instead
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(0.f, 0.f, 0.f, 1.f);
 
-    glUniformMatrix4fv(glGetUniformLocation(m_fire_shader, "proj_mat"), 1, GL_FALSE, &proj_mat[0][0]);
+    glm::mat4 view_mat = m_camera.getViewMatrix();
+    glm::mat4 proj_mat = m_camera.getPerspectiveMatrix();
 
-    glUniformMatrix4fv(glGetUniformLocation(m_fire_shader, "model_mat"), 1, GL_FALSE, &model[0][0]);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(m_fire_shader);
+    glBindVertexArray(m_fire_vao);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, graph.texture("depth"));
+
+    // The billboard basis is the camera's, taken from the rows of the view matrix
+    glm::mat4 view_proj = proj_mat * view_mat;
+    glm::vec3 right(view_mat[0][0], view_mat[1][0], view_mat[2][0]);
+    glm::vec3 up(view_mat[0][1], view_mat[1][1], view_mat[2][1]);
+    glm::vec3 back(view_mat[0][2], view_mat[1][2], view_mat[2][2]);
+    glUniformMatrix4fv(m_u_fire.view_proj, 1, GL_FALSE, &view_proj[0][0]);
+    glUniform3f(m_u_fire.camera_right, right.x, right.y, right.z);
+    glUniform3f(m_u_fire.camera_up, up.x, up.y, up.z);
+    glUniform3f(m_u_fire.camera_back, back.x, back.y, back.z);
+    glUniform1f(m_u_fire.radius, m_radius);
+
+    glUniform1i(m_u_fire.depth_scale, m_particle_downscale);
+    glUniform2f(m_u_fire.depth_params, proj_mat[2][2], proj_mat[3][2]);
+    glUniform1f(m_u_fire.soft_distance, m_particle_soft_distance);
 
-    glDepthMask(GL_FALSE);
     fireLoop();
 
-    // draw triangles
-    glVertexAttribDivisor(0,0);
+    // One 4 vertex strip per particle
     glVertexAttribDivisor(1,1);
     glVertexAttribDivisor(2,1);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, m_vertexData.size()/3.f, m_particles.size());
-    glDepthMask(GL_TRUE);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_particles.size());
+    glDisable(GL_BLEND);
 
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
     glUseProgram(0);
+}
 
-    glBindFramebuffer(GL_FRAMEBUFFER, m_default_fbo);
-    glViewport(0, 0, m_screen_width, m_screen_height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    setBloom();
-    //setKuwahara();
+void Realtime::drawShadowCasters(const glm::mat4 &view, const glm::mat4 &proj) {
+    glUseProgram(m_shader_depth);
+    m_draw_view_proj = proj * view;
+    glUniformMatrix4fv(m_u_depth.view_proj, 1, GL_FALSE, &m_draw_view_proj[0][0]);
+
+    // Frustum planes of the light, each from the last row plus or minus another one
+    const glm::mat4 &view_proj = m_draw_view_proj;
+    glm::vec4 w(view_proj[0][3], view_proj[1][3], view_proj[2][3], view_proj[3][3]);
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        glm::vec4 row(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+        planes[2 * i] = w + row;
+        planes[2 * i + 1] = w - row;
+    }
+    // Primitives fit in a unit cube around their origin
+    auto visible = [&](const glm::mat4 &ctm) {
+        glm::vec3 center(ctm[3]);
+        float radius = 0.87f * std::max({glm::length(glm::vec3(ctm[0])), glm::length(glm::vec3(ctm[1])),
+                                         glm::length(glm::vec3(ctm[2]))});
+        for (const glm::vec4 &plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * glm::length(glm::vec3(plane))) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    setIdentityInstance();
+    for (const RenderShapeData &object : m_renderData.shapes) {
+        // Meshes aren't unit sized, so they are always drawn
+        if (object.primitive.type != PrimitiveType::PRIMITIVE_MESH && !visible(object.ctm)) continue;
+        drawShape(object, 0, 0, true);
+    }
+    for (const RenderTemplateData &templ : m_renderData.templates) {
+        if (templ.instances.empty()) continue;
+        for (const RenderShapeData &object : templ.shapes) {
+            drawShape(object, templ.instance_vbo, templ.instances.size(), true);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
 void Realtime::createShapes() {
     std::set<int> shape_exists;
-    std::vector<RenderShapeData> &shapes = m_renderData.shapes;
-
-    for (int k = 0; k < shapes.size(); k++) {
-        m_parsed = true;
-        RenderShapeData& object = shapes[k];
-        PrimitiveType type = object.primitive.type;
-
-        // Each shape type gets one vbo/vao, NOT multiple per shape
-        if (shape_exists.find(int(type)) == shape_exists.end()) {
-            if (type == PrimitiveType::PRIMITIVE_SPHERE) {
-                Sphere single_sphere;
-                single_sphere.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-                fillVertices(single_sphere, m_vbo_sphere, m_vao_sphere, num_sphere_verts);
-            }
-            else if (type == PrimitiveType::PRIMITIVE_CYLINDER) {
-                Cylinder single_cyl;
-                single_cyl.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-                fillVertices(single_cyl, m_vbo_cyl, m_vao_cyl, num_cyl_verts);
-            }
-            else if (type == PrimitiveType::PRIMITIVE_CONE) {
-                Cone single_cone;
-                single_cone.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-                fillVertices(single_cone, m_vbo_cone, m_vao_cone, num_cone_verts);
-            }
-            else if (type == PrimitiveType::PRIMITIVE_CUBE) {
-                Cube single_cube;
-                single_cube.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-                fillVertices(single_cube, m_vbo_cube, m_vao_cube, num_cube_verts);
-            }
-            shape_exists.insert(int(type));
+
+    for (RenderShapeData &object : m_renderData.shapes) {
+        createShape(object, shape_exists);
+    }
+
+    for (RenderTemplateData &templ : m_renderData.templates) {
+        for (RenderShapeData &object : templ.shapes) {
+            createShape(object, shape_exists);
         }
 
-        // Meshes can't share one vbo/vao like the other shapes because they are each different
-        if (type == PrimitiveType::PRIMITIVE_MESH) {
-            object.shape->updateParams(settings.shapeParameter1, settings.shapeParameter2);
-            fillVertices(*object.shape, object.vbo, object.vao, object.num_verts);
+        // Instance transforms don't depend on the tesselation parameters either.
+        // Each is stored with its normal matrix, see INSTANCE_FLOATS.
+        if (!templ.instance_vbo && !templ.instances.empty()) {
+            std::vector<GLfloat> data;
+            data.reserve(templ.instances.size() * INSTANCE_FLOATS);
+            for (const glm::mat4 &instance : templ.instances) {
+                glm::mat3 normal_mat = glm::inverseTranspose(glm::mat3(instance));
+                data.insert(data.end(), &instance[0][0], &instance[0][0] + 16);
+                data.insert(data.end(), &normal_mat[0][0], &normal_mat[0][0] + 9);
+            }
+            glGenBuffers(1, &templ.instance_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, templ.instance_vbo);
+            glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
         }
     }
 
     old_param1 = settings.shapeParameter1;
     old_param2 = settings.shapeParameter2;
+    // Every cached shadow map may show the old shapes
+    m_geometry_version++;
+}
+
+void Realtime::createShape(RenderShapeData &object, std::set<int> &shape_exists) {
+    m_parsed = true;
+    PrimitiveType type = object.primitive.type;
+    // Once per object here instead of once per vertex in the shaders
+    object.normal_mat = glm::inverseTranspose(glm::mat3(object.ctm));
+
+    // Each shape type gets one vbo/vao, NOT multiple per shape
+    if (shape_exists.find(int(type)) == shape_exists.end()) {
+        if (type == PrimitiveType::PRIMITIVE_SPHERE) {
+            Sphere single_sphere;
+            single_sphere.updateParams(settings.shapeParameter1, settings.shapeParameter2);
+            fillVertices(single_sphere, m_vbo_sphere, m_vao_sphere, num_sphere_verts);
+        }
+        else if (type == PrimitiveType::PRIMITIVE_CYLINDER) {
+            Cylinder single_cyl;
+            single_cyl.updateParams(settings.shapeParameter1, settings.shapeParameter2);
+            fillVertices(single_cyl, m_vbo_cyl, m_vao_cyl, num_cyl_verts);
+        }
+        else if (type == PrimitiveType::PRIMITIVE_CONE) {
+            Cone single_cone;
+            single_cone.updateParams(settings.shapeParameter1, settings.shapeParameter2);
+            fillVertices(single_cone, m_vbo_cone, m_vao_cone, num_cone_verts);
+        }
+        else if (type == PrimitiveType::PRIMITIVE_CUBE) {
+            Cube single_cube;
+            single_cube.updateParams(settings.shapeParameter1, settings.shapeParameter2);
+            fillVertices(single_cube, m_vbo_cube, m_vao_cube, num_cube_verts);
+        }
+        shape_exists.insert(int(type));
+    }
+
+    // Meshes can't share one vbo/vao like the other shapes because they are each different.
+    // They don't depend on the tesselation parameters, so each one is only uploaded once.
+    if (type == PrimitiveType::PRIMITIVE_MESH && !object.vbo && object.upload_id < 0) {
+        object.shape->updateParams(settings.shapeParameter1, settings.shapeParameter2);
+        object.upload_id = m_uploader.uploadBuffer(object.shape->generateShape());
+        m_pending_meshes[object.upload_id] = &object;
+    }
+}
+
+void Realtime::sortDrawList(const glm::mat4 &view) {
+    // Shapes are unit primitives around their origin, so the origin's view depth ranks them
+    auto viewDepth = [&](const glm::mat4 &ctm) {
+        return -(view * ctm[3]).z;
+    };
+
+    m_draw_list.clear();
+    for (const RenderShapeData &object : m_renderData.shapes) {
+        m_draw_list.push_back({&object, 0, 0, viewDepth(object.ctm)});
+    }
+
+    // Every shape of a template is drawn once for all of its instances, ranked by its nearest one
+    for (const RenderTemplateData &templ : m_renderData.templates) {
+        if (templ.instances.empty()) continue;
+        for (const RenderShapeData &object : templ.shapes) {
+            float depth = std::numeric_limits<float>::max();
+            for (const glm::mat4 &instance : templ.instances) {
+                depth = std::min(depth, viewDepth(instance * object.ctm));
+            }
+            m_draw_list.push_back({&object, templ.instance_vbo, int(templ.instances.size()), depth});
+        }
+    }
+
+    std::sort(m_draw_list.begin(), m_draw_list.end(), [](const DrawItem &a, const DrawItem &b) {
+        return a.depth < b.depth;
+    });
+}
+
+void Realtime::drawShape(const RenderShapeData &object, GLuint instance_vbo, int instances, bool depthOnly) {
+    GLuint vao = 0;
+    int num_verts = 0;
+    if (object.primitive.type == PrimitiveType::PRIMITIVE_SPHERE) {
+        vao = m_vao_sphere;
+        num_verts = num_sphere_verts;
+    }
+    else if (object.primitive.type == PrimitiveType::PRIMITIVE_CYLINDER) {
+        vao = m_vao_cyl;
+        num_verts = num_cyl_verts;
+    }
+    else if (object.primitive.type == PrimitiveType::PRIMITIVE_CONE) {
+        vao = m_vao_cone;
+        num_verts = num_cone_verts;
+    }
+    else if (object.primitive.type == PrimitiveType::PRIMITIVE_CUBE) {
+        vao = m_vao_cube;
+        num_verts = num_cube_verts;
+    }
+    else if (object.primitive.type == PrimitiveType::PRIMITIVE_MESH) {
+        vao = object.vao;
+        num_verts = object.num_verts;
+    }
+    // Still uploading
+    if (!vao) return;
+
+    // Instanced draws can't share one mvp, the shaders go through each instance's transform
+    glm::mat4 mvp = m_draw_view_proj * object.ctm;
+    if (depthOnly) {
+        glUniformMatrix4fv(m_u_depth.model_mat, 1, GL_FALSE, &object.ctm[0][0]);
+        glUniformMatrix4fv(m_u_depth.mvp_mat, 1, GL_FALSE, &mvp[0][0]);
+        glUniform1i(m_u_depth.instanced, instance_vbo != 0);
+    } else {
+        glUniformMatrix4fv(m_u_lighting.model_mat, 1, GL_FALSE, &object.ctm[0][0]);
+        glUniformMatrix3fv(m_u_lighting.normal_mat, 1, GL_FALSE, &object.normal_mat[0][0]);
+        glUniformMatrix4fv(m_u_lighting.mvp_mat, 1, GL_FALSE, &mvp[0][0]);
+        glUniform1i(m_u_lighting.instanced, instance_vbo != 0);
+        phongIllumination(object);
+    }
+
+    // After all shaders are setup can actually draw the objects
+    glBindVertexArray(vao);
+    if (!instance_vbo) {
+        glDrawArrays(GL_TRIANGLES, 0, num_verts);
+        return;
+    }
+
+    // The shape vaos are shared by every template, so the instance buffer is attached
+    // for this draw only. A matrix attribute takes one location per column: 2-5 for the
+    // transform, 7-9 for its normal matrix.
+    GLsizei stride = INSTANCE_FLOATS * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    for (int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(2 + i);
+        glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(2 + i, 1);
+    }
+    for (int i = 0; i < 3; i++) {
+        glEnableVertexAttribArray(7 + i);
+        glVertexAttribPointer(7 + i, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(sizeof(glm::mat4) + i * sizeof(glm::vec3)));
+        glVertexAttribDivisor(7 + i, 1);
+    }
+    glDrawArraysInstanced(GL_TRIANGLES, 0, num_verts, instances);
+    for (int i = 0; i < 4; i++) {
+        glDisableVertexAttribArray(2 + i);
+    }
+    for (int i = 0; i < 3; i++) {
+        glDisableVertexAttribArray(7 + i);
+    }
+    setIdentityInstance();
+}
+
+void Realtime::setIdentityInstance() {
+    // Disabled attributes read this constant instead
+    glVertexAttrib4f(2, 1.f, 0.f, 0.f, 0.f);
+    glVertexAttrib4f(3, 0.f, 1.f, 0.f, 0.f);
+    glVertexAttrib4f(4, 0.f, 0.f, 1.f, 0.f);
+    glVertexAttrib4f(5, 0.f, 0.f, 0.f, 1.f);
+    glVertexAttrib3f(7, 1.f, 0.f, 0.f);
+    glVertexAttrib3f(8, 0.f, 1.f, 0.f);
+    glVertexAttrib3f(9, 0.f, 0.f, 1.f);
+}
+
+void Realtime::deleteSceneBuffers() {
+    auto deleteMesh = [](RenderShapeData &object) {
+        if (object.primitive.type == PrimitiveType::PRIMITIVE_MESH && object.vao) {
+            glDeleteBuffers(1, &object.vbo);
+            glDeleteVertexArrays(1, &object.vao);
+        }
+    };
+
+    for (RenderShapeData &object : m_renderData.shapes) {
+        deleteMesh(object);
+    }
+    for (RenderTemplateData &templ : m_renderData.templates) {
+        for (RenderShapeData &object : templ.shapes) {
+            deleteMesh(object);
+        }
+        if (templ.instance_vbo) {
+            glDeleteBuffers(1, &templ.instance_vbo);
+        }
+    }
 }
 
 void Realtime::fillVertices(Shape &shape, GLuint &vbo, GLuint &vao, int &num_verts) {
     std::vector<GLfloat> verts = shape.generateShape();
-    // Position + Normal = One vert
-    num_verts = verts.size() / 6;
+    // Position + Normal + UV = One vert
+    num_verts = verts.size() / 8;
     glGenBuffers(1, &vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.data(), GL_STATIC_DRAW);
 
+    makeVAO(vbo, vao);
+}
+
+void Realtime::makeVAO(GLuint vbo, GLuint &vao) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 24, reinterpret_cast<void*>(0));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 32, reinterpret_cast<void*>(0));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 24, reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 32, reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+    // Locations 2-5 and 7-9 are the instance transform and its normal matrix
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, 32, reinterpret_cast<void*>(6 * sizeof(GLfloat)));
 }
 
-void Realtime::phongIllumination(RenderShapeData object) {
+void Realtime::phongIllumination(const RenderShapeData &object) {
     SceneMaterial material = object.primitive.material;
 
     // Phong Id's
-    glUniform4f(ambient_ID, material.cAmbient.x, material.cAmbient.y, material.cAmbient.z, material.cAmbient.w);
-    glUniform4f(diffuse_ID, material.cDiffuse.x, material.cDiffuse.y, material.cDiffuse.z, material.cDiffuse.w);
-    glUniform4f(specular_ID, material.cSpecular.x, material.cSpecular.y, material.cSpecular.z, material.cSpecular.w);
-    glUniform1f(shininess_ID, material.shininess);
-
-    std::vector<SceneLightData> lights = m_renderData.lights;
-    glUniform1i(light_size_ID, lights.size());
-    for (int i = 0; i < lights.size(); i++) {
-        SceneLightData light = lights[i];
-
-        GLuint light_type_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].type").c_str());
-        glUniform1i(light_type_ID, (int)light.type);
-
-        GLuint light_pos_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].pos").c_str());
-        glUniform4f(light_pos_ID, light.pos.x, light.pos.y, light.pos.z, light.pos.w);
-
-        GLuint light_dir_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].dir").c_str());
-        glUniform4f(light_dir_ID, light.dir.x, light.dir.y, light.dir.z, light.dir.w);
-
-        GLuint light_color_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].color").c_str());
-        glUniform4f(light_color_ID, light.color.x, light.color.y, light.color.z, light.color.w);
-
-        GLuint light_func_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].function").c_str());
-        glUniform3f(light_func_ID, light.function.x, light.function.y, light.function.z);
-
-        GLuint light_angle_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].angle").c_str());
-        glUniform1f(light_angle_ID, light.angle);
-
-        GLuint light_penumbra_ID = glGetUniformLocation(m_shader, ("lights[" + std::to_string(i) + "].penumbra").c_str());
-        glUniform1f(light_penumbra_ID, light.penumbra);
-    }
+    glUniform4f(m_u_lighting.ambient, material.cAmbient.x, material.cAmbient.y, material.cAmbient.z, material.cAmbient.w);
+    glUniform4f(m_u_lighting.diffuse, material.cDiffuse.x, material.cDiffuse.y, material.cDiffuse.z, material.cDiffuse.w);
+    glUniform4f(m_u_lighting.specular, material.cSpecular.x, material.cSpecular.y, material.cSpecular.z, material.cSpecular.w);
+    glUniform1f(m_u_lighting.shininess, material.shininess);
+
+    // Untextured until the image has streamed in
+    const SceneFileMap &map = material.textureMap;
+    int layer = map.isUsed ? m_textures.request(map.filename) : -1;
+    glUniform1i(m_u_lighting.texture_layer, layer);
+    glUniform2f(m_u_lighting.texture_repeat, map.repeatU, map.repeatV);
+    glUniform1f(m_u_lighting.texture_blend, material.blend);
 }
 
-
 void Realtime::resizeGL(int w, int h) {
     // Tells OpenGL how big the screen is
     glViewport(0, 0, size().width() * m_devicePixelRatio, size().height() * m_devicePixelRatio);
@@ -677,14 +1126,21 @@ void Realtime::resizeGL(int w, int h) {
     m_screen_height = size().height() * m_devicePixelRatio;
     m_fbo_width = m_screen_width;
     m_fbo_height = m_screen_height;
-    // Students: anything requiring OpenGL calls when the program starts should be done here
+    // Render targets follow on the next frame: the graph allocates the new size and drops the old
 }
 
 void Realtime::sceneChanged() {
     // Clear render data before parsing again to avoid accumulation
+    deleteSceneBuffers();
     m_renderData = RenderData{};
+    m_pending_meshes.clear();
+    // The history and shadow maps belong to the old scene
+    m_taa_last_frame = -2;
+    m_shadows.invalidate();
     SceneParser parser;
     parser.parse(settings.sceneFilePath, m_renderData);
+    initSkydome();
+    loadLUTs();
 
     // Create new vbo/vaos and then default them to 0
     createShapes();
@@ -712,25 +1168,50 @@ void Realtime::settingsChanged() {
 }
 
 void Realtime::createUniforms() {
-    view_ID = glGetUniformLocation(m_shader, "view_mat");
-    proj_ID = glGetUniformLocation(m_shader, "proj_mat");
-    model_ID = glGetUniformLocation(m_shader, "model_mat");
-    camera_ID = glGetUniformLocation(m_shader, "camera_pos");
-
-    ambient_k_ID = glGetUniformLocation(m_shader, "ka");
-    diffuse_k_ID = glGetUniformLocation(m_shader, "kd");
-    specular_k_ID = glGetUniformLocation(m_shader, "ks");
-
-    ambient_ID = glGetUniformLocation(m_shader, "ambient");
-    diffuse_ID = glGetUniformLocation(m_shader, "diffuse");
-    specular_ID = glGetUniformLocation(m_shader, "specular");
-    shininess_ID = glGetUniformLocation(m_shader, "shininess");
-    light_size_ID = glGetUniformLocation(m_shader, "light_size");
-
-    min_fog_ID = glGetUniformLocation(m_shader, "min_dist");
-    max_fog_ID = glGetUniformLocation(m_shader, "max_dist");
-
-    is_sky_ID = glGetUniformLocation(m_shader, "u_isSky");
+    m_u_lighting.resolve(m_shader);
+    m_u_depth.resolve(m_shader_depth);
+    m_u_sky.resolve(m_shader_sky);
+    m_u_fire.resolve(m_fire_shader);
+    m_u_particle_composite.resolve(m_shader_particle_composite);
+    m_u_bloom_down.resolve(m_shader_bloom_down);
+    m_u_bloom_up.resolve(m_shader_bloom_up);
+    m_u_taa.resolve(m_shader_taa);
+    m_u_kuwahara_prep.resolve(m_shader_kuwahara_prep);
+    m_u_kuwahara.resolve(m_shader_kuwahara);
+    m_u_kuwahara_blur.resolve(m_shader_kuwahara_blur);
+    if (m_shader_kuwahara_compute) {
+        m_u_kuwahara_compute.resolve(m_shader_kuwahara_compute);
+    }
+    m_light_clusters.resolveUniforms(m_shader);
+    m_shadows.resolveUniforms(m_shader);
+
+    // Texture units never change, so samplers are set here once rather than every draw
+    auto sampler = [](GLuint program, const char *name, int unit) {
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, name), unit);
+    };
+    sampler(m_shader, "material_textures", 10);
+    sampler(m_shader, "sky_env", 9);
+    sampler(m_shader_sky, "u_skyTex", 0);
+    sampler(m_fire_shader, "scene_depth", 0);
+    const char *particle_inputs[3] = {"particles", "particles_bright", "scene_depth"};
+    for (int i = 0; i < 3; i++) {
+        sampler(m_shader_particle_composite, particle_inputs[i], i);
+    }
+    sampler(m_shader_bloom_down, "tex", 0);
+    sampler(m_shader_bloom_up, "tex", 0);
+    const char *taa_inputs[4] = {"current", "velocity", "depth", "history"};
+    for (int i = 0; i < 4; i++) {
+        sampler(m_shader_taa, taa_inputs[i], i);
+    }
+    sampler(m_shader_kuwahara_prep, "u_tex", 0);
+    sampler(m_shader_kuwahara_blur, "u_tex", 0);
+    for (GLuint program : {m_shader_kuwahara, m_shader_kuwahara_compute}) {
+        if (!program) continue;
+        sampler(program, "u_tex", 0);
+        sampler(program, "u_tensor", 1);
+    }
+    glUseProgram(0);
 }
 
 void Realtime::makeFullscreenQuad() {
@@ -759,193 +1240,292 @@ void Realtime::makeFullscreenQuad() {
     glBindVertexArray(0);
 }
 
-void Realtime::makeBloomFBO() {
-    // Color buffers
-    glGenFramebuffers(1, &m_fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    // Need color buffer for bright colors and normal colors
-    glGenTextures(2, m_color_buffers);
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindTexture(GL_TEXTURE_2D, m_color_buffers[i]);
-        //glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_fbo_width, m_fbo_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_fbo_width, m_fbo_height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        // Clamp to avoid blur filtering using repeated textures
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // Need to use two different color attachments
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_color_buffers[i], 0);
-    }
-
-    // Renderbuffer
-    glGenRenderbuffers(1, &m_rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_fbo_width, m_fbo_height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_rbo);
-    // Tells opengl there are multiple color buffers
-    GLuint attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
-    glDrawBuffers(2, attachments);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_default_fbo);
-
-    // Ping-pong buffers to blur the color buffers together
-    glGenFramebuffers(2, m_pingpong_fbo);
-    glGenTextures(2, m_pingpong_color);
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_pingpong_fbo[i]);
-        glBindTexture(GL_TEXTURE_2D, m_pingpong_color[i]);
-
-        //glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_fbo_width, m_fbo_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_fbo_width, m_fbo_height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pingpong_color[i], 0);
-        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+void Realtime::loadLUTs() {
+    // The built-in grade, followed by any .cube files next to the scene in name order
+    QStringList sources = {":/resources/cool_tone.cube"};
+    if (!settings.sceneFilePath.empty()) {
+        QDir dir = QFileInfo(QString::fromStdString(settings.sceneFilePath)).dir();
+        for (const QString &name : dir.entryList({"*.cube"}, QDir::Files)) {
+            sources.push_back(dir.filePath(name));
+        }
     }
-    // With two more fbo's, default increase from 2 -> 4
-    m_default_fbo = 4;
-    glBindFramebuffer(GL_FRAMEBUFFER, m_default_fbo);
-}
+    if (sources == m_lut_sources) return;
+    m_lut_sources = sources;
 
-void Realtime::loadLUT() {
-    // From chat for loading the file
-    QFile qfile(":/resources/cool_tone.cube");
-    if (!qfile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "Failed to open LUT file:" << qfile.errorString();
-        return;
+    for (ColorLUT::Texture &lut : m_luts) {
+        glDeleteTextures(1, &lut.texture);
     }
-    QTextStream in(&qfile);
-    int lutSize = 64;
-    std::vector<float> lutData;
-    lutData.reserve(lutSize * lutSize * lutSize * 3);
-
-    while (!in.atEnd()) {
-        QString lineQ = in.readLine();
-        std::string line = lineQ.toStdString();
-
-        if (line.empty() || line[0] == '#') continue;
-        if (line.rfind("LUT_3D_SIZE", 0) == 0) continue;
-
-        float r, g, b;
-        if (sscanf(line.c_str(), "%f %f %f", &r, &g, &b) == 3) {
-            lutData.push_back(r);
-            lutData.push_back(g);
-            lutData.push_back(b);
+    m_luts = {ColorLUT::upload(ColorLUT::identity())};
+    for (const QString &source : sources) {
+        ColorLUT::Table table;
+        if (ColorLUT::load(source, table)) {
+            m_luts.push_back(ColorLUT::upload(table));
         }
     }
-
-    // Load up the texture
-    glGenTextures(1, &m_lut_texture);
-    glBindTexture(GL_TEXTURE_3D, m_lut_texture);
-
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, lutSize, lutSize, lutSize, 0, GL_RGB, GL_FLOAT, lutData.data());
 }
 
-void Realtime::setKuwahara() {
-    glUseProgram(m_shader_kuwahara);
-
-    // Bind default framebuffer (screen)
-    glBindFramebuffer(GL_FRAMEBUFFER, m_default_fbo);
-    glViewport(0, 0, m_screen_width, m_screen_height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    GLuint bloom_ID = glGetUniformLocation(m_shader_kuwahara, "bloom");
-    glUniform1i(bloom_ID, settings.bloom);
-
-    // Bind the scene color buffer as input
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_color_buffers[0]);
-
-    GLint texLoc = glGetUniformLocation(m_shader_kuwahara, "u_tex");
-    glUniform1i(texLoc, 0);
-
-    GLint texelLoc = glGetUniformLocation(m_shader_kuwahara, "u_texelSize");
-    glUniform2f(texelLoc,
-                1.0f / float(m_fbo_width),
-                1.0f / float(m_fbo_height));
-
-    glBindVertexArray(m_fullscreen_vao);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glBindVertexArray(0);
-    glUseProgram(0);
-}
-
-void Realtime::setBloom() {
-    glUseProgram(m_shader_blur);
-    GLuint texture_ID = glGetUniformLocation(m_shader_blur, "tex");
-    glUniform1i(texture_ID, 0);
-
-    bool horizontal = true;
-    bool first_iteration = true;
-    unsigned int amount = 10;
-    for (unsigned int i = 0; i < amount; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_pingpong_fbo[horizontal]);
-        glViewport(0, 0, m_fbo_width, m_fbo_height);
-        GLuint horizontal_ID = glGetUniformLocation(m_shader_blur, "horizontal");
-        glUniform1i(horizontal_ID, horizontal);
-
-        // Alternate the blurring on pingpong buffers but first blurring is on normal scene
+void Realtime::declareKuwahara(RenderGraph &graph, const std::string &scene) {
+    // Quality 3 runs at full resolution, every step below halves it
+    int quality = std::clamp(settings.kuwaharaQuality, 1, 3);
+    int divisor = 1 << (3 - quality);
+    int width = std::max(graph.width() / divisor, 1);
+    int height = std::max(graph.height() / divisor, 1);
+
+    // The kernel keeps the same on-screen size at every quality
+    float radius = std::max(m_kuwahara_radius / divisor, 2.f);
+    // Kernels reach up to twice the radius, which has to fit in the compute shader's apron
+    bool compute = m_shader_kuwahara_compute && 2.f * radius <= 12.f;
+
+    // Downsampled scene + structure tensor, written together
+    graph.createTexture("kuwahara_color", GL_RGBA16F, width, height);
+    graph.createTexture("kuwahara_tensor", GL_RGBA16F, width, height);
+    graph.createTexture("kuwahara_tensor_x", GL_RGBA16F, width, height);
+    graph.createTexture("kuwahara_tensor_smooth", GL_RGBA16F, width, height);
+    graph.createTexture("kuwahara", GL_RGBA16F, width, height);
+
+    // Downsample the scene and find its local orientation
+    graph.addPass("kuwahara_prep", {scene}, {"kuwahara_color", "kuwahara_tensor"}, [this, scene, width, height](RenderGraph &graph) {
+        glUseProgram(m_shader_kuwahara_prep);
+        glBindVertexArray(m_fullscreen_vao);
         glActiveTexture(GL_TEXTURE0);
-        if (first_iteration) {
-            glBindTexture(GL_TEXTURE_2D, m_color_buffers[1]);
-            first_iteration = false;
+        glBindTexture(GL_TEXTURE_2D, graph.texture(scene));
+        glUniform2f(m_u_kuwahara_prep.u_texelSize,
+                    1.0f / float(width),
+                    1.0f / float(height));
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+        glUseProgram(0);
+    });
+
+    // Smooth the tensor with a separable Gaussian, so the orientation is stable across a kernel
+    auto blurTensor = [this](const std::string &source, glm::vec2 direction) {
+        return [this, source, direction](RenderGraph &graph) {
+            glUseProgram(m_shader_kuwahara_blur);
+            glBindVertexArray(m_fullscreen_vao);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+            glUniform2f(m_u_kuwahara_blur.u_direction, direction.x, direction.y);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+            glUseProgram(0);
+        };
+    };
+    graph.addPass("kuwahara_tensor_x", {"kuwahara_tensor"}, {"kuwahara_tensor_x"},
+                  blurTensor("kuwahara_tensor", glm::vec2(1.f / width, 0.f)));
+    graph.addPass("kuwahara_tensor_y", {"kuwahara_tensor_x"}, {"kuwahara_tensor_smooth"},
+                  blurTensor("kuwahara_tensor_x", glm::vec2(0.f, 1.f / height)));
+
+    // The compute shader writes the result as an image, so there is nothing to bind
+    graph.addPass("kuwahara", {"kuwahara_color", "kuwahara_tensor_smooth"}, {"kuwahara"}, [this, width, height, radius, compute](RenderGraph &graph) {
+        GLuint program = compute ? m_shader_kuwahara_compute : m_shader_kuwahara;
+        const KuwaharaUniforms &uniforms = compute ? m_u_kuwahara_compute : m_u_kuwahara;
+
+        glUseProgram(program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.texture("kuwahara_color"));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, graph.texture("kuwahara_tensor_smooth"));
+        glUniform2f(uniforms.u_texelSize,
+                    1.0f / float(width),
+                    1.0f / float(height));
+        glUniform1f(uniforms.u_radius, radius);
+
+        if (compute) {
+            glBindImageTexture(0, graph.texture("kuwahara"), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+            // The composite samples the result
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
         } else {
-            glBindTexture(GL_TEXTURE_2D, m_pingpong_color[!horizontal]);
+            glBindVertexArray(m_fullscreen_vao);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
         }
-        glBindVertexArray(m_fullscreen_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        horizontal = !horizontal;
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, m_default_fbo);
-    glViewport(0, 0, m_screen_width, m_screen_height);
-
-    glUseProgram(m_shader_bloom);
+        glUseProgram(0);
+    }, !compute);
+}
 
-    GLuint bloom_ID = glGetUniformLocation(m_shader_bloom, "bloom");
-    glUniform1i(bloom_ID, settings.bloom);
-    GLuint scene_ID = glGetUniformLocation(m_shader_bloom, "scene");
-    glUniform1i(scene_ID, 0);
-    GLuint blur_ID = glGetUniformLocation(m_shader_bloom, "blur");
+void Realtime::declareBloom(RenderGraph &graph, const std::string &scene) {
+    // Bloom is built at half resolution and below: the bright color buffer is filtered down
+    // the mip chain, then every level is tent-filtered and added onto the next larger one.
+    // Each level is half the size of the previous one, starting at half the fbo resolution
+    int width = graph.width(), height = graph.height();
+    // The bright buffer isn't antialiased, so with TAA the bright parts of the resolved color are used
+    bool threshold = settings.taa;
+    m_bloom_mip_count = 0;
+    for (int i = 0; i < m_bloom_levels && width > 1 && height > 1; i++) {
+        width /= 2;
+        height /= 2;
+        std::string mip = "bloom" + std::to_string(i);
+        // Only the first pass reads the full resolution bright colors
+        std::string source = i > 0 ? "bloom" + std::to_string(i - 1) : threshold ? scene : "bright";
+        graph.createTexture(mip, GL_RGBA16F, width, height);
+        graph.addPass(mip + "_down", {source}, {mip}, [this, source, i, threshold](RenderGraph &graph) {
+            glUseProgram(m_shader_bloom_down);
+            glBindVertexArray(m_fullscreen_vao);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+            glUniform1i(m_u_bloom_down.karis, i == 0);
+            glUniform1i(m_u_bloom_down.threshold, i == 0 && threshold);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+            glUseProgram(0);
+        });
+        m_bloom_mip_count++;
+    }
 
-    glUniform1i(blur_ID, 1);
-    GLuint exposure_ID = glGetUniformLocation(m_shader_bloom, "exposure");
-    glUniform1f(exposure_ID, settings.exposure);
+    for (int i = m_bloom_mip_count - 1; i > 0; i--) {
+        std::string source = "bloom" + std::to_string(i);
+        std::string mip = "bloom" + std::to_string(i - 1);
+        // Reads mip as well, the upsampled level is blended onto what the downsample left there
+        graph.addPass(mip + "_up", {source, mip}, {mip}, [this, source](RenderGraph &graph) {
+            glUseProgram(m_shader_bloom_up);
+            glBindVertexArray(m_fullscreen_vao);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+            glUniform1f(m_u_bloom_up.radius, 1.f);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glDisable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindVertexArray(0);
+            glUseProgram(0);
+        });
+    }
+}
 
-    //Kuwahara filter
-    GLuint kuwahara_ID = glGetUniformLocation(m_shader_bloom, "kuwaharaOn");
-    glUniform1i(kuwahara_ID, settings.bloom); // or settings.bloom
-    GLint texelLoc = glGetUniformLocation(m_shader_bloom, "u_texelSize");
-    glUniform2f(texelLoc,
-                1.0f / float(m_fbo_width),
-                1.0f / float(m_fbo_height));
+void Realtime::makeTAAHistory() {
+    // Storage is allocated by declareTAA once the scene resolution is known
+    glGenTextures(2, m_taa_history);
+    for (GLuint texture : m_taa_history) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    GLuint grade_ID = glGetUniformLocation(m_shader_bloom, "graded");
-    glUniform1i(grade_ID, settings.graded);
-    GLuint LUT_ID = glGetUniformLocation(m_shader_bloom, "LUT");
-    glUniform1i(LUT_ID, 2);
+void Realtime::declareTAA(RenderGraph &graph) {
+    // The history is only usable if last frame resolved into it at the same resolution
+    int width = graph.width(), height = graph.height();
+    bool history_valid = m_taa_last_frame == m_frame - 1;
+    if (width != m_taa_width || height != m_taa_height) {
+        // Same texture objects, so framebuffers the graph built on them stay valid
+        for (GLuint texture : m_taa_history) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_taa_width = width;
+        m_taa_height = height;
+        history_valid = false;
+    }
 
-    glBindVertexArray(m_fullscreen_vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_color_buffers[0]);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_pingpong_color[!horizontal]);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_3D, m_lut_texture);
+    graph.importTexture("taa_history", m_taa_history[m_frame % 2], GL_RGBA16F, width, height);
+    graph.importTexture("taa", m_taa_history[(m_frame + 1) % 2], GL_RGBA16F, width, height);
+    graph.addPass("taa", {"scene", "velocity", "depth", "taa_history"}, {"taa"}, [this, history_valid](RenderGraph &graph) {
+        glUseProgram(m_shader_taa);
+        glBindVertexArray(m_fullscreen_vao);
+        // Bound in the order of the samplers set in createUniforms
+        const char *resources[4] = {"scene", "velocity", "depth", "taa_history"};
+        for (int i = 0; i < 4; i++) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(resources[i]));
+        }
+        glUniform1i(m_u_taa.historyValid, history_valid);
+        glUniform1f(m_u_taa.feedback, 0.1f);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+        glUseProgram(0);
+        glActiveTexture(GL_TEXTURE0);
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+        m_taa_last_frame = m_frame;
+    });
+}
 
-    glUseProgram(0);
+void Realtime::makePostChain() {
+    // Texture unit 0 (the scene) is bound by the chain itself
+    m_post_chain.addPass({"kuwahara",
+        [] { return settings.kuwahara; },
+        [this](RenderGraph &graph, const std::string &scene) { declareKuwahara(graph, scene); },
+        ":/resources/shaders/post/kuwahara.glsl",
+        {"kuwahara"},
+        [this](GLuint program, RenderGraph &graph) {
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, graph.texture("kuwahara"));
+            glUniform1i(m_post_chain.uniform(program, "kuwahara"), 3);
+        }});
+
+    m_post_chain.addPass({"bloom",
+        [] { return settings.bloom; },
+        [this](RenderGraph &graph, const std::string &scene) { declareBloom(graph, scene); },
+        ":/resources/shaders/post/bloom.glsl",
+        {"bloom0"},
+        [this](GLuint program, RenderGraph &graph) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, graph.texture("bloom0"));
+            glUniform1i(m_post_chain.uniform(program, "blur"), 1);
+            // Every level adds about as much energy as the bright colors had, so average them
+            glUniform1f(m_post_chain.uniform(program, "bloomStrength"), 1.f / std::max(m_bloom_mip_count, 1));
+        }});
+
+    m_post_chain.addPass({"tonemap",
+        nullptr,
+        nullptr,
+        ":/resources/shaders/post/tonemap.glsl",
+        {},
+        [this](GLuint program, RenderGraph &) {
+            glUniform1f(m_post_chain.uniform(program, "exposure"), settings.exposure);
+        }});
+
+    m_post_chain.addPass({"lut",
+        [] { return settings.graded; },
+        nullptr,
+        ":/resources/shaders/post/lut.glsl",
+        {},
+        [this](GLuint program, RenderGraph &) {
+            // gradeBlend sweeps through the LUTs in order, mixing the two it falls between
+            float position = std::clamp(settings.gradeBlend, 0.f, 1.f) * (m_luts.size() - 1);
+            int first = std::min(int(position), int(m_luts.size()) - 1);
+            int second = std::min(first + 1, int(m_luts.size()) - 1);
+            const char *samplers[2] = {"lutA", "lutB"};
+            const char *sizes[2] = {"lutSizeA", "lutSizeB"};
+            const char *mins[2] = {"lutDomainMinA", "lutDomainMinB"};
+            const char *maxs[2] = {"lutDomainMaxA", "lutDomainMaxB"};
+            int indices[2] = {first, second};
+            int units[2] = {2, 4}; // Unit 3 belongs to the kuwahara stage
+            for (int i = 0; i < 2; i++) {
+                const ColorLUT::Texture &lut = m_luts[indices[i]];
+                glActiveTexture(GL_TEXTURE0 + units[i]);
+                glBindTexture(GL_TEXTURE_3D, lut.texture);
+                glUniform1i(m_post_chain.uniform(program, samplers[i]), units[i]);
+                glUniform1f(m_post_chain.uniform(program, sizes[i]), lut.size);
+                glUniform3fv(m_post_chain.uniform(program, mins[i]), 1, &lut.domainMin[0]);
+                glUniform3fv(m_post_chain.uniform(program, maxs[i]), 1, &lut.domainMax[0]);
+            }
+            glUniform1f(m_post_chain.uniform(program, "lutBlend"), position - first);
+        }});
+
+    m_post_chain.addPass({"vignette",
+        [] { return settings.vignetteGrain; },
+        nullptr,
+        ":/resources/shaders/post/vignette.glsl",
+        {},
+        [this](GLuint program, RenderGraph &) {
+            glUniform1f(m_post_chain.uniform(program, "vignetteStrength"), 0.6f);
+        }});
+
+    m_post_chain.addPass({"grain",
+        [] { return settings.vignetteGrain; },
+        nullptr,
+        ":/resources/shaders/post/grain.glsl",
+        {},
+        [this](GLuint program, RenderGraph &) {
+            glUniform1f(m_post_chain.uniform(program, "grainAmount"), 0.04f);
+            glUniform1f(m_post_chain.uniform(program, "grainSeed"), float(m_frame % 1024));
+        }});
 }
 
 // ================== Camera Movement!
@@ -1038,7 +1618,6 @@ void Realtime::timerEvent(QTimerEvent *event) {
     update(); // asks for a PaintGL() call to occur
 }
 
-// DO NOT EDIT
 void Realtime::saveViewportImage(std::string filePath) {
     // Make sure we have the right context and everything has been drawn
     makeCurrent();
@@ -1058,33 +1637,30 @@ void Realtime::saveViewportImage(std::string filePath) {
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, fixedWidth, fixedHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
 
-    // Optional: Create a depth buffer if your rendering uses depth testing
-    GLuint rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, fixedWidth, fixedHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         std::cerr << "Error: Framebuffer is not complete!" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
         return;
     }
 
-    // Render to the FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glViewport(0, 0, fixedWidth, fixedHeight);
-
-    // Clear and render your scene here
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    paintGL();
+    // The whole frame is rendered at the image's size, with the composite writing into our FBO
+    int cameraWidth = m_camera.width, cameraHeight = m_camera.height;
+    m_camera.width = fixedWidth;
+    m_camera.height = fixedHeight;
+    renderFrame(fbo, fixedWidth, fixedHeight, 1.f);
+    m_camera.width = cameraWidth;
+    m_camera.height = cameraHeight;
+    m_fbo_width = m_screen_width;
+    m_fbo_height = m_screen_height;
 
     // Read pixels from framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
     std::vector<unsigned char> pixels(fixedWidth * fixedHeight * 3);
     glReadPixels(0, 0, fixedWidth, fixedHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
 
     // Unbind the framebuffer to return to default rendering to the screen
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 
     // Convert to QImage
     QImage image(pixels.data(), fixedWidth, fixedHeight, QImage::Format_RGB888);
@@ -1098,6 +1674,5 @@ void Realtime::saveViewportImage(std::string filePath) {
 
     // Clean up
     glDeleteTextures(1, &texture);
-    glDeleteRenderbuffers(1, &rbo);
     glDeleteFramebuffers(1, &fbo);
 }
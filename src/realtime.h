@@ -16,6 +16,16 @@
 #include <set>
 
 #include "utils/sceneparser.h"
+#include "utils/gluploader.h"
+#include "utils/postchain.h"
+#include "utils/rendergraph.h"
+#include "utils/resolutionscaler.h"
+#include "utils/lightclusters.h"
+#include "utils/shadowmaps.h"
+#include "utils/texturemanager.h"
+#include "utils/colorlut.h"
+#include "utils/shaderuniforms.h"
+#include "utils/shaderreloader.h"
 #include "camera/camera.h"
 
 class Realtime : public QOpenGLWidget
@@ -56,23 +66,58 @@ private:
     double m_devicePixelRatio;
 
     // Id stores
-    GLuint m_shader, m_shader_bloom, m_shader_blur, m_shader_kuwahara;
-    GLuint m_default_fbo, m_fbo, m_rbo;
-    GLuint m_color_buffers[2], m_pingpong_fbo[2], m_pingpong_color[2];
-    GLuint m_lut_texture;
-    GLuint m_kuwahara_fbo, m_kuwahara_tex;
+    GLuint m_shader, m_shader_depth, m_shader_bloom_down, m_shader_bloom_up, m_shader_kuwahara, m_shader_kuwahara_prep, m_shader_kuwahara_blur, m_shader_taa, m_shader_sky, m_shader_particle_composite;
+    GLuint m_shader_kuwahara_compute = 0; // Only with GL 4.3
+    // Grading LUTs blended by settings.gradeBlend, the first is the identity
+    std::vector<ColorLUT::Texture> m_luts;
+    QStringList m_lut_sources;
+
+    // Every render target is a transient owned by the graph, rebuilt each frame
+    RenderGraph m_graph;
+    // Per-froxel light lists, rebuilt every frame for the current camera
+    LightClusters m_light_clusters;
+    // Redrawn only for the lights, cascades and geometry that changed
+    ShadowMaps m_shadows;
+    // Material textures, streamed in as shapes ask for them
+    TextureManager m_textures;
+    int m_geometry_version = 0;         // Bumped whenever a shadow caster changes
+    // Chooses the scene resolution (m_fbo_width/height) from GPU frame times
+    ResolutionScaler m_resolution;
+
+    float m_kuwahara_radius = 8.f; // In full resolution pixels
+
+    // TAA resolves into one history texture while reading the other, swapping every frame
+    GLuint m_taa_history[2];
+    int m_taa_width = 0, m_taa_height = 0;
+    int m_taa_last_frame = -2;          // Frame the history was last written, to detect gaps
+    glm::mat4 m_view_proj, m_prev_view_proj; // Unjittered, for the velocity buffer
+    glm::mat4 m_draw_view_proj;              // Of the pass drawShape draws for, each object's MVP starts from it
 
     GLuint m_fullscreen_vbo, m_fullscreen_vao;
-    GLuint m_vbo_sphere, m_vbo_cyl, m_vbo_cone, m_vbo_cube, m_vbo_sky;
-    GLuint m_vao_sphere, m_vao_cyl, m_vao_cone, m_vao_cube, m_vao_sky;
+    GLuint m_vbo_sphere, m_vbo_cyl, m_vbo_cone, m_vbo_cube;
+    GLuint m_vao_sphere, m_vao_cyl, m_vao_cone, m_vao_cube;
+
+    // Builds the programs above, and rebuilds them when their files change in dev mode
+    ShaderReloader m_shader_reloader;
+
+    // Uniform locations of each program, filled in by createUniforms
+    LightingUniforms m_u_lighting;
+    DepthUniforms m_u_depth;
+    SkyUniforms m_u_sky;
+    FireUniforms m_u_fire;
+    ParticleCompositeUniforms m_u_particle_composite;
+    BloomDownUniforms m_u_bloom_down;
+    BloomUpUniforms m_u_bloom_up;
+    TAAUniforms m_u_taa;
+    KuwaharaUniforms m_u_kuwahara_prep, m_u_kuwahara, m_u_kuwahara_compute;
+    KuwaharaBlurUniforms m_u_kuwahara_blur;
 
-    GLuint view_ID, proj_ID, model_ID, camera_ID;
-    GLuint ambient_k_ID, diffuse_k_ID, specular_k_ID;
-    GLuint ambient_ID, diffuse_ID, specular_ID, shininess_ID, light_size_ID;
-    GLuint min_fog_ID, max_fog_ID;
+    // Bloom mip chain, level 0 is half the fbo resolution
+    int m_bloom_levels = 6;
+    int m_bloom_mip_count = 0; // Levels that fit this frame
 
     // Vertices vars
-    int num_sphere_verts, num_cyl_verts, num_cone_verts, num_cube_verts, num_sky_verts = 0;
+    int num_sphere_verts, num_cyl_verts, num_cone_verts, num_cube_verts;
 
     // Random vars
     RenderData m_renderData;
@@ -83,39 +128,80 @@ private:
     bool m_parsed = false;
     float m_fog = 0;
     float m_fog_rate = 0.025f;
+    int m_frame = 0;
+
+    // Kuwahara, bloom, tone mapping, grading... in the order they are applied
+    PostChain m_post_chain;
+    std::string m_post_order;  // settings.postOrder as last applied to m_post_chain
 
 
     // Functions
     void makeFullscreenQuad();
-    void makeBloomFBO();
-    void loadLUT();
-    void setBloom();
-    void setKuwahara();
+    void loadLUTs();
+    void makePostChain();
+    void declareBloom(RenderGraph &graph, const std::string &scene);
+    void declareKuwahara(RenderGraph &graph, const std::string &scene);
+    void makeTAAHistory();
+    void declareTAA(RenderGraph &graph);
+    // Renders a frame of the given size into target through the render graph, with the
+    // scene itself rendered at scale times that size
+    void renderFrame(GLuint target, int width, int height, float scale);
+    void drawScene();
     void createShapes();
+    void createShape(RenderShapeData &object, std::set<int> &shape_exists);
+    // Floats per template instance: its mat4 transform, then the mat3 normal matrix
+    static const int INSTANCE_FLOATS = 16 + 9;
+    // Draws one shape, or one shape per template instance if instance_vbo is set.
+    // depthOnly draws with m_shader_depth bound and skips the material uniforms.
+    void drawShape(const RenderShapeData &object, GLuint instance_vbo, int instances, bool depthOnly = false);
+    // Opaque draws of the frame, nearest first so early-Z rejects as much as possible
+    struct DrawItem {
+        const RenderShapeData *object;
+        GLuint instance_vbo;
+        int instances;
+        float depth;
+    };
+    std::vector<DrawItem> m_draw_list;
+    void sortDrawList(const glm::mat4 &view);
+    // Depth-only draw of everything inside the light's frustum, for m_shadows
+    void drawShadowCasters(const glm::mat4 &view, const glm::mat4 &proj);
+    void setIdentityInstance();
+    void deleteSceneBuffers();
     void fillVertices(Shape &shape, GLuint &vbo, GLuint &vao, int &num_verts);
-    void phongIllumination(RenderShapeData object);
+    void makeVAO(GLuint vbo, GLuint &vao);
+    void phongIllumination(const RenderShapeData &object);
     void createUniforms();
     glm::mat3 rodrigues(float theta, glm::vec3 axis);
 
+    // Background uploads: upload id -> shape in m_renderData waiting for it
+    GLUploader m_uploader;
+    std::unordered_map<int, RenderShapeData *> m_pending_meshes;
+    void collectUploads();
+
     //Skydome variables and functions
-    GLuint m_skyTexture = 0;
-    GLuint is_sky_ID;
-    void drawSkydome(glm::vec3 camera_pos);
+    GLuint m_skyTexture = 0;          // Cubemap
+    int m_sky_size = 0;               // Face size of m_skyTexture
+    int m_sky_upload = -1;
+    QString m_sky_source;
+    // Fills every pixel left uncovered by the opaque pass, see sky.vert
+    void drawSky(const glm::mat4 &view, const glm::mat4 &proj);
     void initSkydome();
 
     // Fire variables and functions
     void fireLoop();
-    void createCircle(float tessalations, float z);
-    void makeCircleSlice(float currentTheta, float nextTheta, float z);
-    void makeCircleTile(glm::vec3 bottomRight, glm::vec3 top, glm::vec3 bottomLeft);
+    // Summarizes the particles as a few point lights in m_fire_lights
+    void updateFireLights(const glm::mat4 &view);
+    // Particles are drawn into "particles"/"particles_bright" at 1/m_particle_downscale of the
+    // scene resolution, faded against the scene depth, then upsampled over "scene"/"bright"
+    void declareParticles(RenderGraph &graph);
+    void drawParticles(RenderGraph &graph);
 
-    int m_tessalations = 4;
     GLuint m_fire_shader;
-    GLuint m_fire_vbo;
     GLuint m_fire_vao;
-    std::vector<float> m_vertexData;
 
-    float m_radius = 0.008f;
+    float m_radius = 0.008f;  // Billboard half size
+    int m_particle_downscale = 2;           // 2 for half, 4 for quarter resolution particles
+    float m_particle_soft_distance = 0.05f;
     struct Particle {
         glm::vec3 position, velocity;
         glm::vec3 color = glm::vec3{0,1,0};
@@ -146,6 +232,17 @@ private:
     float m_heat_transfer = 0.5;
     float m_heat_decay = 0.25;
 
+    //fire lights
+    std::vector<SceneLightData> m_fire_lights;
+    std::vector<SceneLightData> m_frame_lights;  // Scene lights + fire lights
+    std::vector<float> m_fire_cell_heat;         // Smoothed heat share of each grid cell
+    int m_fire_light_cols = 4;
+    int m_fire_light_rows = 4;
+    int m_fire_light_count = 4;
+    float m_fire_light_height = 3.f;
+    float m_fire_light_min_heat = 0.5f;
+    float m_fire_light_intensity = 4.f;
+
     //bounds
     float m_side_bound = 0.8f;
     float m_ground_bound = 0.0f;
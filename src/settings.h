@@ -5,6 +5,7 @@
 
 struct Settings {
     std::string sceneFilePath;
+    std::string shaderDir; // Dev mode: shaders are loaded from here and reloaded on change
     int shapeParameter1 = 1;
     int shapeParameter2 = 1;
     float nearPlane = 1;
@@ -16,8 +17,18 @@ struct Settings {
     float exposure = 1;
     bool bloom = false;
     bool graded = false;
-    bool extraCredit3 = false;
-    bool extraCredit4 = false;
+    float gradeBlend = 1; // Position along the LUTs, 0 is ungraded
+    bool kuwahara = false;
+    int kuwaharaQuality = 2;
+    bool vignetteGrain = false;
+    // Post passes by name, comma separated; unlisted ones run after these in their default order
+    std::string postOrder = "kuwahara,bloom,tonemap,lut,vignette,grain";
+    bool dynamicResolution = true;
+    bool taa = true;
+    bool depthPrepass = true;
+    bool fireLights = true;
+    bool shadows = true;
+    bool skyAmbient = false;
 };
 
 
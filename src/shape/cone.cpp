@@ -60,18 +60,21 @@ void Cone::makeSlopeSlice(float currentTheta, float nextTheta){
             // Deal with base to tip slope slice
             insertVec3(m_vertexData, bottomLeft);
             insertVec3(m_vertexData, calcNorm(bottomLeft));
+            insertVec2(m_vertexData, glm::vec2(calcU(currentTheta), bottomY + 0.5f));
             insertVec3(m_vertexData, tip);
             insertVec3(m_vertexData, tipNormal);
+            insertVec2(m_vertexData, glm::vec2(calcU((currentTheta + nextTheta) / 2.f), 1.f));
             insertVec3(m_vertexData, bottomRight);
             insertVec3(m_vertexData, calcNorm(bottomRight));
+            insertVec2(m_vertexData, glm::vec2(calcU(nextTheta), bottomY + 0.5f));
         } else {
-            makeSlopeTile(topLeft, topRight, bottomLeft, bottomRight);
+            makeSlopeTile(topLeft, topRight, bottomLeft, bottomRight, calcU(currentTheta), calcU(nextTheta));
         }
     }
 }
 
 
-void Cone::makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight) {
+void Cone::makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, float uLeft, float uRight) {
     glm::vec3 normTL = calcNorm(topLeft);
     glm::vec3 normTR = calcNorm(topRight);
     glm::vec3 normBL = calcNorm(bottomLeft);
@@ -79,17 +82,33 @@ void Cone::makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottom
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normTL);
+    insertVec2(m_vertexData, glm::vec2(uLeft, topLeft.y + 0.5f));
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, normTR);
+    insertVec2(m_vertexData, glm::vec2(uRight, topRight.y + 0.5f));
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, normBL);
+    insertVec2(m_vertexData, glm::vec2(uLeft, bottomLeft.y + 0.5f));
 
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, normTR);
+    insertVec2(m_vertexData, glm::vec2(uRight, topRight.y + 0.5f));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normBR);
+    insertVec2(m_vertexData, glm::vec2(uRight, bottomRight.y + 0.5f));
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, normBL);
+    insertVec2(m_vertexData, glm::vec2(uLeft, bottomLeft.y + 0.5f));
+}
+
+
+float Cone::calcU(float theta) {
+    return 1.f - theta / glm::radians(360.f);
+}
+
+
+glm::vec2 Cone::calcCapUV(glm::vec3 &pt) {
+    return glm::vec2(pt.x + 0.5f, pt.z + 0.5f);
 }
 
 
@@ -124,17 +143,23 @@ void Cone::makeCapTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLe
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(topLeft));
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(bottomLeft));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(bottomRight));
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(topLeft));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(bottomRight));
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(topRight));
 }
 
 
@@ -144,3 +169,8 @@ void Cone::insertVec3(std::vector<float> &data, glm::vec3 v) {
     data.push_back(v.z);
 }
 
+void Cone::insertVec2(std::vector<float> &data, glm::vec2 v) {
+    data.push_back(v.x);
+    data.push_back(v.y);
+}
+
@@ -66,19 +66,37 @@ void Cube::makeFace(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft,
 
 
 void Cube::makeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight) {
+    glm::vec3 face = calcNorm(topLeft, bottomLeft, bottomRight);
+
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, calcNorm(topLeft, bottomLeft, bottomRight));
+    insertVec2(m_vertexData, calcUV(topLeft, face));
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, calcNorm(bottomLeft, bottomRight, topLeft));
+    insertVec2(m_vertexData, calcUV(bottomLeft, face));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, calcNorm(bottomRight, topLeft, bottomLeft));
+    insertVec2(m_vertexData, calcUV(bottomRight, face));
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, calcNorm(topLeft, bottomRight, topRight));
+    insertVec2(m_vertexData, calcUV(topLeft, face));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, calcNorm(bottomRight, topRight, topLeft));
+    insertVec2(m_vertexData, calcUV(bottomRight, face));
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, calcNorm(topRight, topLeft, bottomRight));
+    insertVec2(m_vertexData, calcUV(topRight, face));
+}
+
+
+glm::vec2 Cube::calcUV(glm::vec3 &pt, glm::vec3 normal) {
+    if (normal.x > 0.5f) return glm::vec2(-pt.z + 0.5f, pt.y + 0.5f);
+    if (normal.x < -0.5f) return glm::vec2(pt.z + 0.5f, pt.y + 0.5f);
+    if (normal.y > 0.5f) return glm::vec2(pt.x + 0.5f, -pt.z + 0.5f);
+    if (normal.y < -0.5f) return glm::vec2(pt.x + 0.5f, pt.z + 0.5f);
+    if (normal.z > 0.5f) return glm::vec2(pt.x + 0.5f, pt.y + 0.5f);
+    return glm::vec2(-pt.x + 0.5f, pt.y + 0.5f);
 }
 
 
@@ -93,3 +111,8 @@ void Cube::insertVec3(std::vector<float> &data, glm::vec3 v) {
     data.push_back(v.z);
 }
 
+void Cube::insertVec2(std::vector<float> &data, glm::vec2 v) {
+    data.push_back(v.x);
+    data.push_back(v.y);
+}
+
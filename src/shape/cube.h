@@ -17,7 +17,10 @@ private:
     void makeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight);
     void makeFace(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight);
     glm::vec3 calcNorm(glm::vec3& pt1, glm::vec3& pt2, glm::vec3& pt3);
+    // Planar mapping of the face with the given normal, upright on the side faces
+    glm::vec2 calcUV(glm::vec3 &pt, glm::vec3 normal);
     void insertVec3(std::vector<float> &data, glm::vec3 v);
+    void insertVec2(std::vector<float> &data, glm::vec2 v);
 };
 
 #endif // CUBE_H
@@ -46,12 +46,12 @@ void Cylinder::makeSlopeSlice(float currentTheta, float nextTheta){
         glm::vec3 bottomLeft = glm::vec3(0.5f * cos(currentTheta), bottomY, 0.5f * sin(currentTheta));
         glm::vec3 bottomRight = glm::vec3(0.5 * cos(nextTheta), bottomY, 0.5f * sin(nextTheta));
 
-        makeSlopeTile(topLeft, topRight, bottomLeft, bottomRight);
+        makeSlopeTile(topLeft, topRight, bottomLeft, bottomRight, calcU(currentTheta), calcU(nextTheta));
     }
 }
 
 
-void Cylinder::makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight) {
+void Cylinder::makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, float uLeft, float uRight) {
     glm::vec3 normTL = calcNorm(topLeft);
     glm::vec3 normTR = calcNorm(topRight);
     glm::vec3 normBL = calcNorm(bottomLeft);
@@ -59,17 +59,33 @@ void Cylinder::makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bo
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normTL);
+    insertVec2(m_vertexData, glm::vec2(uLeft, topLeft.y + 0.5f));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normBR);
+    insertVec2(m_vertexData, glm::vec2(uRight, bottomRight.y + 0.5f));
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, normBL);
+    insertVec2(m_vertexData, glm::vec2(uLeft, bottomLeft.y + 0.5f));
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normTL);
+    insertVec2(m_vertexData, glm::vec2(uLeft, topLeft.y + 0.5f));
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, normTR);
+    insertVec2(m_vertexData, glm::vec2(uRight, topRight.y + 0.5f));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normBR);
+    insertVec2(m_vertexData, glm::vec2(uRight, bottomRight.y + 0.5f));
+}
+
+
+float Cylinder::calcU(float theta) {
+    return 1.f - theta / glm::radians(360.f);
+}
+
+
+glm::vec2 Cylinder::calcCapUV(glm::vec3 &pt) {
+    return pt.y > 0.f ? glm::vec2(pt.x + 0.5f, -pt.z + 0.5f) : glm::vec2(pt.x + 0.5f, pt.z + 0.5f);
 }
 
 
@@ -104,17 +120,23 @@ void Cylinder::makeCapSlice(float currentTheta, float nextTheta, float y, glm::v
 void Cylinder::makeCapTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, glm::vec3 normal) {
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(topLeft));
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(bottomLeft));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(bottomRight));
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(topLeft));
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(bottomRight));
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, normal);
+    insertVec2(m_vertexData, calcCapUV(topRight));
 }
 
 void Cylinder::insertVec3(std::vector<float> &data, glm::vec3 v) {
@@ -122,3 +144,8 @@ void Cylinder::insertVec3(std::vector<float> &data, glm::vec3 v) {
     data.push_back(v.y);
     data.push_back(v.z);
 }
+
+void Cylinder::insertVec2(std::vector<float> &data, glm::vec2 v) {
+    data.push_back(v.x);
+    data.push_back(v.y);
+}
@@ -17,11 +17,16 @@ private:
 
     void makeWedge(float currentTheta, float nextTheta);
     void makeSlopeSlice(float currentTheta, float nextTheta);
-    void makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight);
+    void makeSlopeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, float uLeft, float uRight);
     glm::vec3 calcNorm(glm::vec3& pt);
     void makeCapSlice(float currentTheta, float nextTheta, float y, glm::vec3 normal);
     void makeCapTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, glm::vec3 normal);
+    // u around the axis (from theta, so the seam gets u = 1), v along it
+    float calcU(float theta);
+    // Caps are mapped flat, seen from outside
+    glm::vec2 calcCapUV(glm::vec3 &pt);
     void insertVec3(std::vector<float> &data, glm::vec3 v);
+    void insertVec2(std::vector<float> &data, glm::vec2 v);
 };
 
 #endif // CYLINDER_H
@@ -20,10 +20,24 @@ ObjLoader::ObjLoader(std::string mesh_file) {
                 float vert_val = std::stof(word);
                 vertices.push_back(vert_val);
             }
+        } else if (word == "vt") {
+            // Only u and v, an optional w is ignored
+            float u = 0.f, v = 0.f;
+            ss >> u >> v;
+            uvs.push_back(u);
+            uvs.push_back(v);
         } else if (word == "f") {
+            // Corners are v, v/vt, v/vt/vn or v//vn
             while (ss >> word) {
                 int face_val = std::stoi(word);
                 faces.push_back(face_val);
+
+                size_t slash = word.find('/');
+                int uv_val = 0;
+                if (slash != std::string::npos && slash + 1 < word.size() && word[slash + 1] != '/') {
+                    uv_val = std::stoi(word.substr(slash + 1));
+                }
+                face_uvs.push_back(uv_val);
             }
         }
     }
@@ -52,18 +66,26 @@ void ObjLoader::setVertexData() {
         int val3 = faces[i+2] - 1;
         glm::vec3 pt3 = glm::vec3(vertices[3*val3], vertices[3*val3 + 1], vertices[3*val3 + 2]);
 
-        makeTile(pt1, pt2, pt3);
+        auto uv = [&](int corner) {
+            int index = face_uvs[corner] - 1;
+            if (index < 0 || 2*index + 1 >= uvs.size()) return glm::vec2(0.f);
+            return glm::vec2(uvs[2*index], uvs[2*index + 1]);
+        };
+        makeTile(pt1, pt2, pt3, uv(i), uv(i+1), uv(i+2));
     }
 }
 
 
-void ObjLoader::makeTile(glm::vec3 pt1, glm::vec3 pt2, glm::vec3 pt3) {
+void ObjLoader::makeTile(glm::vec3 pt1, glm::vec3 pt2, glm::vec3 pt3, glm::vec2 uv1, glm::vec2 uv2, glm::vec2 uv3) {
     insertVec3(m_vertexData, pt1);
     insertVec3(m_vertexData, calcNorm(pt1, pt2, pt3));
+    insertVec2(m_vertexData, uv1);
     insertVec3(m_vertexData, pt2);
     insertVec3(m_vertexData, calcNorm(pt2, pt3, pt1));
+    insertVec2(m_vertexData, uv2);
     insertVec3(m_vertexData, pt3);
     insertVec3(m_vertexData, calcNorm(pt3, pt1, pt2));
+    insertVec2(m_vertexData, uv3);
 }
 
 
@@ -78,3 +100,8 @@ void ObjLoader::insertVec3(std::vector<float> &data, glm::vec3 v) {
     data.push_back(v.z);
 }
 
+void ObjLoader::insertVec2(std::vector<float> &data, glm::vec2 v) {
+    data.push_back(v.x);
+    data.push_back(v.y);
+}
+
@@ -20,14 +20,17 @@ public:
 
     ObjLoader();
     ObjLoader(std::string mesh_file);
-    void makeTile(glm::vec3 pt1, glm::vec3 pt2, glm::vec3 pt3);
+    void makeTile(glm::vec3 pt1, glm::vec3 pt2, glm::vec3 pt3, glm::vec2 uv1, glm::vec2 uv2, glm::vec2 uv3);
     glm::vec3 calcNorm(glm::vec3& pt1, glm::vec3& pt2, glm::vec3& pt3);
     void insertVec3(std::vector<float> &data, glm::vec3 v);
+    void insertVec2(std::vector<float> &data, glm::vec2 v);
 
 private:
     std::vector<float> m_vertexData;
     std::vector<float> vertices;
     std::vector<int> faces;
+    std::vector<float> uvs;
+    std::vector<int> face_uvs; // Index into uvs per face corner, 0 when the file gives none
 };
 
 #endif // OBJLOADER_H
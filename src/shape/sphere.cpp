@@ -49,30 +49,44 @@ void Sphere::makeWedge(float currentTheta, float nextTheta) {
                                           0.5f * cos(phi2),
                                          -0.5f * sin(phi2) * sin(nextTheta));
 
-        makeTile(topLeft, topRight, bottomLeft, bottomRight);
+        // u follows theta and v latitude, so the seam vertices get u = 1 rather than wrapping to 0
+        glm::vec2 uvMin(currentTheta / glm::radians(360.f), 1.f - phi2 / glm::radians(180.f));
+        glm::vec2 uvMax(nextTheta / glm::radians(360.f), 1.f - phi1 / glm::radians(180.f));
+        makeTile(topLeft, topRight, bottomLeft, bottomRight, uvMin, uvMax);
     }
 }
 
 
-void Sphere::makeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight) {
+void Sphere::makeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, glm::vec2 uvMin, glm::vec2 uvMax) {
     glm::vec3 normTL = glm::normalize(topLeft);
     glm::vec3 normTR = glm::normalize(topRight);
     glm::vec3 normBL = glm::normalize(bottomLeft);
     glm::vec3 normBR = glm::normalize(bottomRight);
 
+    glm::vec2 uvTL(uvMin.x, uvMax.y);
+    glm::vec2 uvTR = uvMax;
+    glm::vec2 uvBL = uvMin;
+    glm::vec2 uvBR(uvMax.x, uvMin.y);
+
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normTL);
+    insertVec2(m_vertexData, uvTL);
     insertVec3(m_vertexData, bottomLeft);
     insertVec3(m_vertexData, normBL);
+    insertVec2(m_vertexData, uvBL);
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normBR);
+    insertVec2(m_vertexData, uvBR);
 
     insertVec3(m_vertexData, topLeft);
     insertVec3(m_vertexData, normTL);
+    insertVec2(m_vertexData, uvTL);
     insertVec3(m_vertexData, bottomRight);
     insertVec3(m_vertexData, normBR);
+    insertVec2(m_vertexData, uvBR);
     insertVec3(m_vertexData, topRight);
     insertVec3(m_vertexData, normTR);
+    insertVec2(m_vertexData, uvTR);
 }
 
 void Sphere::insertVec3(std::vector<float> &data, glm::vec3 v) {
@@ -80,3 +94,8 @@ void Sphere::insertVec3(std::vector<float> &data, glm::vec3 v) {
     data.push_back(v.y);
     data.push_back(v.z);
 }
+
+void Sphere::insertVec2(std::vector<float> &data, glm::vec2 v) {
+    data.push_back(v.x);
+    data.push_back(v.y);
+}
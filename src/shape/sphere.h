@@ -17,8 +17,10 @@ private:
 
     void makeSphere();
     void makeWedge(float currTheta, float nextTheta);
-    void makeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight);
+    // uvMin is the bottom left corner of the tile in texture space, uvMax the top right
+    void makeTile(glm::vec3 topLeft, glm::vec3 topRight, glm::vec3 bottomLeft, glm::vec3 bottomRight, glm::vec2 uvMin, glm::vec2 uvMax);
     void insertVec3(std::vector<float> &data, glm::vec3 v);
+    void insertVec2(std::vector<float> &data, glm::vec2 v);
 };
 
 #endif // SPHERE_H
@@ -0,0 +1,24 @@
+#include "cachefile.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+QString CacheFile::path(const QString &source, const QString &dir, const QString &suffix) {
+    QString key = QString::fromLatin1(QCryptographicHash::hash(QFileInfo(source).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex());
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/" + dir + "/" + key + suffix;
+}
+
+void CacheFile::stamp(const QString &source, int64_t &size, int64_t &modified) {
+    QFileInfo info(source);
+    size = info.size();
+    // Missing files have no time, they fail to load anyway
+    modified = info.lastModified().isValid() ? info.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+std::string CacheFile::stamp(const QString &source) {
+    int64_t size, modified;
+    stamp(source, size, modified);
+    return std::to_string(size) + " " + std::to_string(modified);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QString>
+
+#include <cstdint>
+#include <string>
+
+// Files derived from a source asset (converted images, parsed LUTs, flattened scenes) live in
+// the user's cache directory, named by a hash of the source's path. The source's stamp is
+// stored with them so a cache made from an older version of the file is not used.
+class CacheFile {
+public:
+    // CacheLocation/<dir>/<SHA-1 of the source's absolute path><suffix>
+    static QString path(const QString &source, const QString &dir, const QString &suffix);
+
+    // Size and modification time of the source; for resources, the time rcc embedded
+    static void stamp(const QString &source, int64_t &size, int64_t &modified);
+    // The same as text, for caches storing it as a string
+    static std::string stamp(const QString &source);
+};
@@ -0,0 +1,220 @@
+#include "colorlut.h"
+#include "cachefile.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <glm/gtc/packing.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[4] = {'F', 'L', 'U', 'T'};
+const uint32_t VERSION = 1;
+// Sizes above this are not worth a 3D texture (256^3 alone would be 100 MB)
+const int MAX_SIZE = 256;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    // Used to reject caches whose .cube file has been edited since
+    int64_t sourceSize;
+    int64_t sourceModified;
+
+    int32_t size;
+    float domainMin[3];
+    float domainMax[3];
+};
+
+// Skips spaces and tabs, but not line ends
+const char *skipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+bool startsWith(const char *p, const char *end, const char *keyword) {
+    size_t length = strlen(keyword);
+    return size_t(end - p) >= length && memcmp(p, keyword, length) == 0;
+}
+
+bool parse(const QByteArray &text, ColorLUT::Table &table) {
+    const char *p = text.constData();
+    const char *end = p + text.size();
+    size_t count = 0;
+
+    while (p < end) {
+        const char *line_end = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!line_end) line_end = end;
+        p = skipSpaces(p, line_end);
+
+        // Keywords come before the data, comments and blank lines can appear anywhere
+        if (p == line_end || *p == '#' || *p == '\r' || startsWith(p, line_end, "TITLE")) {
+        } else if (startsWith(p, line_end, "LUT_3D_SIZE")) {
+            table.size = std::atoi(p + strlen("LUT_3D_SIZE"));
+            if (table.size < 2 || table.size > MAX_SIZE) {
+                std::cerr << "[LUT] Unsupported LUT_3D_SIZE " << table.size << std::endl;
+                return false;
+            }
+            table.data.resize(size_t(table.size) * table.size * table.size * 3);
+        } else if (startsWith(p, line_end, "LUT_1D_SIZE")) {
+            std::cerr << "[LUT] 1D LUTs are not supported" << std::endl;
+            return false;
+        } else if (startsWith(p, line_end, "DOMAIN_MIN") || startsWith(p, line_end, "DOMAIN_MAX")) {
+            glm::vec3 &domain = p[8] == 'I' ? table.domainMin : table.domainMax;
+            char *next = const_cast<char *>(p + strlen("DOMAIN_MIN"));
+            for (int c = 0; c < 3; c++) domain[c] = std::strtof(next, &next);
+        } else if (startsWith(p, line_end, "LUT_3D_INPUT_RANGE")) {
+            char *next = const_cast<char *>(p + strlen("LUT_3D_INPUT_RANGE"));
+            float min = std::strtof(next, &next);
+            float max = std::strtof(next, &next);
+            table.domainMin = glm::vec3(min);
+            table.domainMax = glm::vec3(max);
+        } else {
+            // Data line, which must not come before the size
+            if (count == table.data.size()) {
+                std::cerr << "[LUT] Unexpected line, or more entries than LUT_3D_SIZE allows" << std::endl;
+                return false;
+            }
+            char *next = const_cast<char *>(p);
+            for (int c = 0; c < 3; c++) {
+                char *value_end;
+                float value = std::strtof(next, &value_end);
+                if (value_end == next) {
+                    std::cerr << "[LUT] Malformed entry " << count / 3 << std::endl;
+                    return false;
+                }
+                table.data[count++] = glm::packHalf1x16(value);
+                next = value_end;
+            }
+        }
+        p = line_end + 1;
+    }
+
+    if (table.size == 0 || count != table.data.size()) {
+        std::cerr << "[LUT] Expected " << table.data.size() / 3 << " entries, found " << count / 3 << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool readCache(const QString &path, const QString &source, ColorLUT::Table &table) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray bytes = file.readAll();
+    if (bytes.size() < qsizetype(sizeof(Header))) {
+        return false;
+    }
+
+    Header header{};
+    memcpy(&header, bytes.constData(), sizeof(Header));
+    int64_t sourceSize, sourceModified;
+    CacheFile::stamp(source, sourceSize, sourceModified);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.sourceSize != sourceSize || header.sourceModified != sourceModified
+        || header.size < 2 || header.size > MAX_SIZE) {
+        return false;
+    }
+    size_t entries = size_t(header.size) * header.size * header.size * 3;
+    if (uint64_t(bytes.size()) != sizeof(Header) + entries * sizeof(uint16_t)) {
+        return false;
+    }
+
+    table.size = header.size;
+    table.domainMin = glm::vec3(header.domainMin[0], header.domainMin[1], header.domainMin[2]);
+    table.domainMax = glm::vec3(header.domainMax[0], header.domainMax[1], header.domainMax[2]);
+    table.data.resize(entries);
+    memcpy(table.data.data(), bytes.constData() + sizeof(Header), entries * sizeof(uint16_t));
+    return true;
+}
+
+void writeCache(const QString &path, const QString &source, const ColorLUT::Table &table) {
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    CacheFile::stamp(source, header.sourceSize, header.sourceModified);
+    header.size = table.size;
+    for (int c = 0; c < 3; c++) {
+        header.domainMin[c] = table.domainMin[c];
+        header.domainMax[c] = table.domainMax[c];
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "[LUT] Could not write cache " << path.toStdString() << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(table.data.data()), table.data.size() * sizeof(uint16_t));
+    file.commit();
+}
+
+}
+
+QString ColorLUT::cachePath(const QString &source) {
+    return CacheFile::path(source, "luts", ".flut");
+}
+
+bool ColorLUT::load(const QString &source, Table &table) {
+    QString cache = cachePath(source);
+    if (readCache(cache, source, table)) {
+        return true;
+    }
+
+    QFile file(source);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "[LUT] Failed to open " << source.toStdString() << std::endl;
+        return false;
+    }
+    table = Table{};
+    if (!parse(file.readAll(), table)) {
+        std::cerr << "[LUT] Failed to parse " << source.toStdString() << std::endl;
+        return false;
+    }
+    writeCache(cache, source, table);
+    return true;
+}
+
+ColorLUT::Table ColorLUT::identity() {
+    // Trilinear filtering reproduces the input exactly from the corners alone
+    Table table;
+    table.size = 2;
+    for (int b = 0; b < 2; b++) {
+        for (int g = 0; g < 2; g++) {
+            for (int r = 0; r < 2; r++) {
+                table.data.push_back(glm::packHalf1x16(float(r)));
+                table.data.push_back(glm::packHalf1x16(float(g)));
+                table.data.push_back(glm::packHalf1x16(float(b)));
+            }
+        }
+    }
+    return table;
+}
+
+ColorLUT::Texture ColorLUT::upload(const Table &table) {
+    Texture lut;
+    lut.size = table.size;
+    lut.domainMin = table.domainMin;
+    lut.domainMax = table.domainMax;
+
+    glGenTextures(1, &lut.texture);
+    glBindTexture(GL_TEXTURE_3D, lut.texture);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Rows of an odd sized RGB16F LUT aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, table.size, table.size, table.size, 0, GL_RGB, GL_HALF_FLOAT, table.data.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return lut;
+}
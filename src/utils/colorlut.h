@@ -0,0 +1,45 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+// 3D color grading LUTs in the Adobe/Resolve .cube format. Parsed tables are cached as half
+// floats next to the other caches, so a launch only reads the text file when it has changed.
+class ColorLUT {
+public:
+    struct Table {
+        int size = 0;
+        glm::vec3 domainMin = glm::vec3(0.f);
+        glm::vec3 domainMax = glm::vec3(1.f);
+        std::vector<uint16_t> data;      // size^3 half float RGB triplets, red changing fastest
+    };
+
+    // A LUT as uploaded, with what the shader needs to address it
+    struct Texture {
+        GLuint texture = 0;
+        int size = 0;
+        glm::vec3 domainMin = glm::vec3(0.f);
+        glm::vec3 domainMax = glm::vec3(1.f);
+    };
+
+    // Reads the cached table of a .cube file on disk or in the Qt resources, parsing and
+    // caching it if the cache is missing or stale. Returns false if the file is not a valid 3D LUT.
+    static bool load(const QString &source, Table &table);
+
+    // Maps every color to itself, used as the ungraded end of a blend
+    static Table identity();
+
+    static Texture upload(const Table &table);
+
+    // Where the parsed table of source is stored
+    static QString cachePath(const QString &source);
+};
@@ -0,0 +1,112 @@
+#include "environmentmap.h"
+#include "texturecodec.h"
+#include "cachefile.h"
+
+#include <QImage>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// A quarter of the equirectangular width keeps roughly the source's texel density
+const int MAX_FACE_SIZE = 1024;
+
+// Direction through texel (x, y) of a face, following the GL cubemap face orientation
+glm::vec3 faceDirection(int face, int x, int y, int size) {
+    float s = 2.f * (x + 0.5f) / size - 1.f;
+    float t = 2.f * (y + 0.5f) / size - 1.f;
+    switch (face) {
+    case 0: return glm::vec3(1.f, -t, -s);
+    case 1: return glm::vec3(-1.f, -t, s);
+    case 2: return glm::vec3(s, 1.f, t);
+    case 3: return glm::vec3(s, -1.f, -t);
+    case 4: return glm::vec3(s, -t, 1.f);
+    default: return glm::vec3(-s, -t, -1.f);
+    }
+}
+
+// Bilinear lookup with the same mapping the sky shader used to do per pixel
+glm::vec4 sampleEquirect(const QImage &img, const glm::vec3 &dir) {
+    float u = std::atan2(dir.z, dir.x) / (2.f * M_PI) + 0.5f;
+    float v = std::asin(std::clamp(dir.y, -1.f, 1.f)) / M_PI + 0.5f;
+
+    // The image's first row is the top of the sky
+    float px = u * img.width() - 0.5f;
+    float py = (1.f - v) * img.height() - 0.5f;
+    int x0 = int(std::floor(px)), y0 = int(std::floor(py));
+    float fx = px - x0, fy = py - y0;
+
+    auto texel = [&](int x, int y) {
+        x = (x % img.width() + img.width()) % img.width(); // Wraps around the seam
+        y = std::clamp(y, 0, img.height() - 1);
+        const uchar *p = img.constScanLine(y) + x * 4;
+        return glm::vec4(p[0], p[1], p[2], p[3]);
+    };
+    return glm::mix(glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx),
+                    glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx), fy);
+}
+
+void convert(const QImage &img, bool compressed, Ktx2::Image &cubemap) {
+    // Power of two, so every mip halves evenly
+    int size = 1;
+    while (size * 2 <= std::min(MAX_FACE_SIZE, img.width() / 4)) size *= 2;
+
+    std::vector<std::vector<uint8_t>> faces(6, std::vector<uint8_t>(size_t(size) * size * 4));
+    for (int face = 0; face < 6; face++) {
+        uint8_t *out = faces[face].data();
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                glm::vec4 color = sampleEquirect(img, glm::normalize(faceDirection(face, x, y, size)));
+                for (int c = 0; c < 4; c++) {
+                    *out++ = uint8_t(std::clamp(color[c] + 0.5f, 0.f, 255.f));
+                }
+            }
+        }
+    }
+
+    // The mip chain doubles as a prefiltered environment for ambient lookups
+    cubemap.format = compressed ? Ktx2::FORMAT_BC1 : Ktx2::FORMAT_RGBA8;
+    cubemap.size = size;
+    cubemap.faces = 6;
+    cubemap.levels.clear();
+    for (int level_size = size; ; level_size /= 2) {
+        std::vector<uint8_t> level;
+        for (std::vector<uint8_t> &face : faces) {
+            std::vector<uint8_t> data = compressed ? TextureCodec::encodeBC1(face, level_size) : face;
+            level.insert(level.end(), data.begin(), data.end());
+        }
+        cubemap.levels.push_back(std::move(level));
+        if (level_size == 1) break;
+        for (std::vector<uint8_t> &face : faces) {
+            face = TextureCodec::halve(face, level_size);
+        }
+    }
+}
+
+}
+
+QString EnvironmentMap::cachePath(const QString &source, bool compressed) {
+    return CacheFile::path(source, "environment", compressed ? "_bc1.ktx2" : ".ktx2");
+}
+
+bool EnvironmentMap::load(const QString &source, bool compressed, Ktx2::Image &cubemap) {
+    std::string stamp = CacheFile::stamp(source);
+    QString cache = cachePath(source, compressed);
+    if (Ktx2::read(cache, stamp, cubemap) && cubemap.faces == 6
+        && cubemap.format == (compressed ? Ktx2::FORMAT_BC1 : Ktx2::FORMAT_RGBA8)) {
+        return true;
+    }
+
+    QImage img(source);
+    if (img.isNull()) {
+        std::cerr << "[Environment] Failed to load image " << source.toStdString() << std::endl;
+        return false;
+    }
+    convert(img.convertToFormat(QImage::Format_RGBA8888), compressed, cubemap);
+    Ktx2::write(cache, cubemap, stamp);
+    return true;
+}
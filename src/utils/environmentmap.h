@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ktx2.h"
+
+#include <QString>
+
+// Converts equirectangular sky images into mipmapped cubemaps. The conversion runs once per
+// image: the result is cached as KTX2 in the user's cache directory, BC1 compressed when the
+// GPU can sample that, so later launches skip JPEG decoding, resampling and mip generation.
+class EnvironmentMap {
+public:
+    // Loads the cubemap of an image on disk or in the Qt resources, converting and caching
+    // it if the cache is missing or older than the image. Faces are in GL order
+    // (+X, -X, +Y, -Y, +Z, -Z), first row first. Safe to call from any thread.
+    static bool load(const QString &source, bool compressed, Ktx2::Image &cubemap);
+
+    // Where the converted cubemap of source is stored
+    static QString cachePath(const QString &source, bool compressed);
+};
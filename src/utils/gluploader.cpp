@@ -0,0 +1,202 @@
+#include "gluploader.h"
+#include "environmentmap.h"
+
+#include <algorithm>
+#include <iostream>
+
+GLUploader::~GLUploader() {
+    stop();
+}
+
+void GLUploader::start(QOpenGLContext *shareContext) {
+    // The surface has to be created on the GUI thread, the context is then handed to the worker
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(shareContext->format());
+    m_surface->create();
+
+    m_context = new QOpenGLContext();
+    m_context->setFormat(shareContext->format());
+    m_context->setShareContext(shareContext);
+    if (!m_context->create() || !QOpenGLContext::areSharing(m_context, shareContext)) {
+        std::cerr << "[Uploader] Could not create a shared context, uploading on the render thread" << std::endl;
+        delete m_context;
+        m_context = nullptr;
+        m_synchronous = true;
+        return;
+    }
+
+    m_context->moveToThread(this);
+    m_synchronous = false;
+    m_stopping = false;
+    QThread::start();
+}
+
+void GLUploader::stop() {
+    if (isRunning()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_jobs.clear();
+        }
+        m_cv.notify_all();
+        wait();
+    }
+
+    // Objects live in the shared namespace, so the caller's context can clean them up
+    for (Upload &upload : m_done) {
+        glDeleteSync(upload.fence);
+        if (upload.type == UploadType::UPLOAD_BUFFER) {
+            glDeleteBuffers(1, &upload.name);
+        } else {
+            glDeleteTextures(1, &upload.name);
+        }
+    }
+    m_done.clear();
+
+    delete m_context;
+    m_context = nullptr;
+    if (m_surface) {
+        m_surface->destroy();
+        delete m_surface;
+        m_surface = nullptr;
+    }
+}
+
+int GLUploader::uploadBuffer(std::vector<GLfloat> data) {
+    Job job;
+    job.type = UploadType::UPLOAD_BUFFER;
+    job.data = std::move(data);
+    return enqueue(std::move(job));
+}
+
+int GLUploader::uploadCubemap(const QString &filepath) {
+    Job job;
+    job.type = UploadType::UPLOAD_CUBEMAP;
+    job.filepath = filepath;
+    return enqueue(std::move(job));
+}
+
+int GLUploader::enqueue(Job job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    job.id = m_next_id++;
+    int id = job.id;
+
+    if (m_synchronous) {
+        lock.unlock();
+        Upload upload = process(job);
+        lock.lock();
+        m_done.push_back(upload);
+        return id;
+    }
+
+    m_jobs.push_back(std::move(job));
+    lock.unlock();
+    m_cv.notify_one();
+    return id;
+}
+
+std::vector<GLUploader::Upload> GLUploader::collect() {
+    std::vector<Upload> ready;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (int i = 0; i < m_done.size();) {
+        // Zero timeout: only checks the fence, never blocks the frame
+        GLenum status = glClientWaitSync(m_done[i].fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glDeleteSync(m_done[i].fence);
+            m_done[i].fence = 0;
+            ready.push_back(m_done[i]);
+            m_done.erase(m_done.begin() + i);
+        } else if (status == GL_WAIT_FAILED) {
+            // The fence will never signal, so the upload can't be trusted and is dropped
+            std::cerr << "[Uploader] Waiting on upload " << m_done[i].id << " failed, dropping it" << std::endl;
+            glDeleteSync(m_done[i].fence);
+            if (m_done[i].type == UploadType::UPLOAD_BUFFER) {
+                glDeleteBuffers(1, &m_done[i].name);
+            } else {
+                glDeleteTextures(1, &m_done[i].name);
+            }
+            m_done.erase(m_done.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    return ready;
+}
+
+void GLUploader::run() {
+    m_context->makeCurrent(m_surface);
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping) {
+                break;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Upload upload = process(job);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done.push_back(upload);
+    }
+
+    m_context->doneCurrent();
+}
+
+GLUploader::Upload GLUploader::process(Job &job) {
+    Upload upload;
+    upload.id = job.id;
+    upload.type = job.type;
+
+    if (job.type == UploadType::UPLOAD_BUFFER) {
+        upload.size = job.data.size();
+        glGenBuffers(1, &upload.name);
+        glBindBuffer(GL_ARRAY_BUFFER, upload.name);
+        glBufferData(GL_ARRAY_BUFFER, job.data.size() * sizeof(GLfloat), job.data.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    } else {
+        // Conversion (or reading the cached result) stays off the render thread as well
+        bool compressed = GLEW_EXT_texture_compression_s3tc;
+        Ktx2::Image cubemap;
+        if (EnvironmentMap::load(job.filepath, compressed, cubemap)) {
+            upload.width = cubemap.size;
+            upload.height = cubemap.size;
+
+            glGenTextures(1, &upload.name);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, upload.name);
+            // Every mip comes from the cache, nothing is generated on the GPU
+            int size = cubemap.size;
+            for (int level = 0; level < cubemap.levels.size(); level++) {
+                size_t face_bytes = cubemap.levels[level].size() / 6;
+                for (int i = 0; i < 6; i++) {
+                    const uint8_t *data = cubemap.levels[level].data() + i * face_bytes;
+                    if (compressed) {
+                        glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                               size, size, 0, face_bytes, data);
+                    } else {
+                        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_RGBA8, size, size,
+                                     0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+                    }
+                }
+                size = std::max(size / 2, 1);
+            }
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, cubemap.levels.size() - 1);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        }
+    }
+
+    // Flushing makes the fence visible to the render thread's context
+    upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    return upload;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QString>
+#include <QThread>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Worker thread owning a GL context that shares objects with the widget's context.
+// Buffers and textures are created and filled there, then handed back to the render
+// thread together with a fence so drawing never stalls on a large transfer.
+class GLUploader : public QThread
+{
+public:
+    enum class UploadType {
+        UPLOAD_BUFFER,
+        UPLOAD_CUBEMAP
+    };
+
+    // A finished upload, picked up by the render thread once its fence has signaled
+    struct Upload {
+        int id;
+        UploadType type;
+        GLuint name = 0;             // Buffer or texture id, valid in every context sharing with ours
+        GLsync fence = 0;            // Signaled when the GPU has consumed the data
+        int size = 0;                // Number of floats for buffers
+        int width = 0, height = 0;   // Only applicable to textures, face size for cubemaps
+    };
+
+    ~GLUploader() override;
+
+    // Must be called on the GUI thread while the widget's context is current
+    void start(QOpenGLContext *shareContext);
+    // Stops the worker and deletes anything that was uploaded but never collected
+    void stop();
+
+    // Queue work for the uploader; the returned id matches Upload::id
+    int uploadBuffer(std::vector<GLfloat> data);
+    // Equirectangular image converted to a mipmapped cubemap, see EnvironmentMap
+    int uploadCubemap(const QString &filepath);
+
+    // Returns the uploads whose fence has signaled, uploads whose fence can't be waited on are
+    // deleted and never returned. Called on the render thread.
+    std::vector<Upload> collect();
+
+protected:
+    void run() override;
+
+private:
+    struct Job {
+        int id;
+        UploadType type;
+        std::vector<GLfloat> data;
+        QString filepath;
+    };
+
+    int enqueue(Job job);
+    Upload process(Job &job);
+
+    QOpenGLContext *m_context = nullptr;
+    QOffscreenSurface *m_surface = nullptr;
+    // If the shared context can't be made, uploads happen immediately on the caller's thread
+    bool m_synchronous = true;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_jobs;
+    std::vector<Upload> m_done;
+    bool m_stopping = false;
+    int m_next_id = 0;
+};
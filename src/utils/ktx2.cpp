@@ -0,0 +1,196 @@
+#include "ktx2.h"
+#include "texturecodec.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+const char SOURCE_KEY[] = "FLSource";
+
+struct Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Header) == 80, "KTX2 header is 80 bytes");
+
+// Basic data format descriptor with a single sample covering the texel block
+std::vector<uint32_t> descriptor(uint32_t format) {
+    bool bc1 = format == Ktx2::FORMAT_BC1;
+    std::vector<uint32_t> dfd;
+    uint32_t samples = bc1 ? 1 : 4;
+    uint32_t block_size = 24 + 16 * samples;
+    dfd.push_back(4 + block_size);                              // dfdTotalSize
+    dfd.push_back(0);                                           // vendor 0 (Khronos), basic descriptor
+    dfd.push_back(2 | (block_size << 16));                      // version 2
+    // Color model (BC1A or RGBSDA), BT.709 primaries, linear transfer
+    dfd.push_back((bc1 ? 128u : 1u) | (1u << 8) | (1u << 16));
+    dfd.push_back(bc1 ? (3u | (3u << 8)) : 0u);                 // Block dimensions - 1
+    dfd.push_back(bc1 ? 8u : 4u);                               // Bytes per block
+    dfd.push_back(0);
+    if (bc1) {
+        dfd.insert(dfd.end(), {uint32_t(63 << 16), 0, 0, 0xffffffffu});
+    } else {
+        for (uint32_t c = 0; c < 4; c++) {
+            // R, G, B, then alpha (channel 15), 8 bits each
+            uint32_t channel = c == 3 ? 15 : c;
+            dfd.insert(dfd.end(), {(c * 8) | (7u << 16) | (channel << 24), 0, 0, 255});
+        }
+    }
+    return dfd;
+}
+
+size_t align(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+}
+
+bool Ktx2::write(const QString &filepath, const Image &image, const std::string &source) {
+    QDir().mkpath(QFileInfo(filepath).absolutePath());
+
+    std::vector<uint32_t> dfd = descriptor(image.format);
+
+    std::vector<uint8_t> kvd;
+    uint32_t kv_length = sizeof(SOURCE_KEY) + source.size() + 1;
+    kvd.resize(4);
+    memcpy(kvd.data(), &kv_length, 4);
+    kvd.insert(kvd.end(), SOURCE_KEY, SOURCE_KEY + sizeof(SOURCE_KEY));
+    kvd.insert(kvd.end(), source.begin(), source.end());
+    kvd.push_back(0);
+    kvd.resize(align(kvd.size(), 4), 0);
+
+    Header header = {};
+    memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+    header.vkFormat = image.format;
+    header.typeSize = 1;
+    header.pixelWidth = image.size;
+    header.pixelHeight = image.size;
+    header.faceCount = image.faces;
+    header.levelCount = image.levels.size();
+
+    size_t offset = sizeof(Header) + image.levels.size() * sizeof(LevelIndex);
+    header.dfdByteOffset = offset;
+    header.dfdByteLength = dfd.size() * 4;
+    offset += header.dfdByteLength;
+    header.kvdByteOffset = offset;
+    header.kvdByteLength = kvd.size();
+    offset += kvd.size();
+
+    // Levels are stored smallest first, each aligned to the texel block size
+    std::vector<LevelIndex> levels(image.levels.size());
+    for (int i = int(image.levels.size()) - 1; i >= 0; i--) {
+        offset = align(offset, 8);
+        levels[i] = {offset, image.levels[i].size(), image.levels[i].size()};
+        offset += image.levels[i].size();
+    }
+
+    // QSaveFile only replaces the old cache once everything has been written
+    QSaveFile file(filepath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "[KTX2] Could not write " << filepath.toStdString() << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(levels.data()), levels.size() * sizeof(LevelIndex));
+    file.write(reinterpret_cast<const char *>(dfd.data()), dfd.size() * 4);
+    file.write(reinterpret_cast<const char *>(kvd.data()), kvd.size());
+    size_t written = header.kvdByteOffset + kvd.size();
+    for (int i = int(image.levels.size()) - 1; i >= 0; i--) {
+        static const char padding[8] = {};
+        file.write(padding, levels[i].byteOffset - written);
+        file.write(reinterpret_cast<const char *>(image.levels[i].data()), image.levels[i].size());
+        written = levels[i].byteOffset + levels[i].byteLength;
+    }
+    return file.commit();
+}
+
+bool Ktx2::read(const QString &filepath, const std::string &source, Image &image) {
+    QFile file(filepath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray data = file.readAll();
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data.constData());
+    uint64_t size = data.size();
+
+    Header header;
+    if (size < sizeof(Header)) return false;
+    memcpy(&header, bytes, sizeof(Header));
+    if (memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.supercompressionScheme != 0
+        || (header.vkFormat != FORMAT_RGBA8 && header.vkFormat != FORMAT_BC1)
+        || header.pixelWidth == 0 || header.pixelWidth != header.pixelHeight
+        || header.levelCount == 0 || header.levelCount > 16
+        || (header.faceCount != 1 && header.faceCount != 6)
+        || uint64_t(header.kvdByteOffset) + header.kvdByteLength > size) {
+        return false;
+    }
+
+    // Only our own source entry is looked for
+    std::string stored;
+    const uint8_t *kv = bytes + header.kvdByteOffset;
+    const uint8_t *kv_end = kv + header.kvdByteLength;
+    while (kv + 4 <= kv_end) {
+        uint32_t length;
+        memcpy(&length, kv, 4);
+        if (kv + 4 + length > kv_end) break;
+        const char *entry = reinterpret_cast<const char *>(kv + 4);
+        // The value is NUL terminated inside the entry, a corrupt one may not be
+        if (length > sizeof(SOURCE_KEY) && memcmp(entry, SOURCE_KEY, sizeof(SOURCE_KEY)) == 0
+            && entry[length - 1] == '\0') {
+            stored = std::string(entry + sizeof(SOURCE_KEY), length - sizeof(SOURCE_KEY) - 1);
+        }
+        kv += align(4 + length, 4);
+    }
+    if (stored != source || sizeof(Header) + uint64_t(header.levelCount) * sizeof(LevelIndex) > size) {
+        return false;
+    }
+
+    image.format = header.vkFormat;
+    image.size = header.pixelWidth;
+    image.faces = header.faceCount;
+    image.levels.assign(header.levelCount, {});
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        LevelIndex level;
+        memcpy(&level, bytes + sizeof(Header) + i * sizeof(LevelIndex), sizeof(LevelIndex));
+        // Each level has to be exactly what the upload will read for its format and size
+        int level_size = std::max(int(header.pixelWidth >> i), 1);
+        size_t face_bytes = header.vkFormat == FORMAT_BC1 ? TextureCodec::bc1Bytes(level_size)
+                                                          : size_t(level_size) * level_size * 4;
+        if (level.byteLength != face_bytes * header.faceCount
+            || level.byteOffset > size || level.byteLength > size - level.byteOffset) {
+            return false;
+        }
+        image.levels[i].assign(bytes + level.byteOffset, bytes + level.byteOffset + level.byteLength);
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal KTX2 container for the texture caches: 2D images or cubemaps with a full mip chain,
+// stored uncompressed or as BC1, no supercompression. A key/value entry records what the
+// file was made from so stale caches can be told apart.
+class Ktx2 {
+public:
+    // Vulkan format numbers, as KTX2 uses them
+    static const uint32_t FORMAT_RGBA8 = 37;   // VK_FORMAT_R8G8B8A8_UNORM
+    static const uint32_t FORMAT_BC1 = 131;    // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+
+    struct Image {
+        uint32_t format = FORMAT_RGBA8;
+        int size = 0;                            // Width and height of level 0
+        int faces = 1;                           // 6 for cubemaps
+        // Level 0 first, every level holds all faces back to back
+        std::vector<std::vector<uint8_t>> levels;
+    };
+
+    // @param source   Identifies the input (e.g. its size and timestamp), checked by read
+    static bool write(const QString &filepath, const Image &image, const std::string &source);
+    // Fails if the file is missing, malformed or was written for a different source
+    static bool read(const QString &filepath, const std::string &source, Image &image);
+};
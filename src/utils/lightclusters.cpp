@@ -0,0 +1,197 @@
+#include "lightclusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// A light is ignored where it would add less than this to a channel
+const float CUTOFF = 1.f / 256.f;
+
+}
+
+void LightClusters::init() {
+    auto makeBuffer = [](GLuint &buffer, GLuint &texture, GLenum format) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    };
+    makeBuffer(m_light_buffer, m_light_texture, GL_RGBA32F);
+    makeBuffer(m_grid_buffer, m_grid_texture, GL_RG32UI);
+    makeBuffer(m_index_buffer, m_index_texture, GL_R32UI);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::destroy() {
+    GLuint textures[3] = {m_light_texture, m_grid_texture, m_index_texture};
+    GLuint buffers[3] = {m_light_buffer, m_grid_buffer, m_index_buffer};
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+void LightClusters::buildFroxels(float near, float far, float heightAngle, float aspect) {
+    if (near == m_near && far == m_far && heightAngle == m_height_angle && aspect == m_aspect
+        && !m_froxels.empty()) {
+        return;
+    }
+    m_near = near;
+    m_far = far;
+    m_height_angle = heightAngle;
+    m_aspect = aspect;
+
+    float tan_y = std::tan(heightAngle / 2.f);
+    float tan_x = tan_y * aspect;
+    m_froxels.resize(TILES_X * TILES_Y * SLICES);
+    for (int z = 0; z < SLICES; z++) {
+        // Exponential slices keep froxels roughly cube shaped at every distance
+        float d0 = near * std::pow(far / near, float(z) / SLICES);
+        float d1 = near * std::pow(far / near, float(z + 1) / SLICES);
+        for (int y = 0; y < TILES_Y; y++) {
+            float y0 = -1.f + 2.f * y / TILES_Y, y1 = -1.f + 2.f * (y + 1) / TILES_Y;
+            for (int x = 0; x < TILES_X; x++) {
+                float x0 = -1.f + 2.f * x / TILES_X, x1 = -1.f + 2.f * (x + 1) / TILES_X;
+
+                Bounds &bounds = m_froxels[(z * TILES_Y + y) * TILES_X + x];
+                bounds.min = glm::vec3(std::numeric_limits<float>::max());
+                bounds.max = glm::vec3(-std::numeric_limits<float>::max());
+                for (float d : {d0, d1}) {
+                    for (float nx : {x0, x1}) {
+                        for (float ny : {y0, y1}) {
+                            glm::vec3 corner(nx * d * tan_x, ny * d * tan_y, -d);
+                            bounds.min = glm::min(bounds.min, corner);
+                            bounds.max = glm::max(bounds.max, corner);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+float LightClusters::lightRange(const SceneLightData &light, float far) {
+    // Attenuation is min(1, 1 / (c + l*d + q*d^2)), solve for where it reaches the cutoff
+    float brightest = std::max(light.color.r, std::max(light.color.g, light.color.b));
+    float limit = brightest / CUTOFF;
+    float c = light.function.x, l = light.function.y, q = light.function.z;
+    if (q > 0.f) {
+        float discriminant = l * l - 4.f * q * (c - limit);
+        return std::max((-l + std::sqrt(std::max(discriminant, 0.f))) / (2.f * q), 0.f);
+    }
+    if (l > 0.f) {
+        return std::max((limit - c) / l, 0.f);
+    }
+    // Constant attenuation never falls off
+    return far * 2.f;
+}
+
+void LightClusters::update(const std::vector<SceneLightData> &lights, const std::vector<int> &shadowLayers,
+                           const glm::mat4 &view, float near, float far, float heightAngle, float aspect) {
+    buildFroxels(near, far, heightAngle, aspect);
+
+    auto pushLight = [&](int i) {
+        const SceneLightData &light = lights[i];
+        float shadow = shadowLayers.empty() ? -1.f : float(shadowLayers[i]);
+        m_light_data.push_back(glm::vec4(glm::vec3(light.pos), float(int(light.type))));
+        m_light_data.push_back(glm::vec4(glm::vec3(light.dir), light.angle));
+        m_light_data.push_back(glm::vec4(glm::vec3(light.color), light.penumbra));
+        m_light_data.push_back(glm::vec4(light.function, shadow));
+    };
+
+    m_light_data.clear();
+    m_hits.clear();
+
+    for (int i = 0; i < lights.size(); i++) {
+        if (lights[i].type == LightType::LIGHT_DIRECTIONAL) pushLight(i);
+    }
+    m_directional_count = m_light_data.size() / 4;
+
+    float slice_scale = SLICES / std::log(far / near);
+    auto sliceOf = [&](float depth) {
+        return std::clamp(int(std::log(depth / near) * slice_scale), 0, SLICES - 1);
+    };
+
+    for (int i = 0; i < lights.size(); i++) {
+        const SceneLightData &light = lights[i];
+        if (light.type == LightType::LIGHT_DIRECTIONAL) continue;
+        int index = m_light_data.size() / 4;
+        pushLight(i);
+
+        // Spot lights are binned by their full sphere, which is conservative
+        glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(light.pos), 1.f));
+        float range = lightRange(light, far);
+        float depth = -center.z;
+        if (depth + range < near || depth - range > far) continue;
+
+        int first = sliceOf(std::max(depth - range, near));
+        int last = sliceOf(std::min(depth + range, far));
+        for (int z = first; z <= last; z++) {
+            for (int froxel = z * TILES_X * TILES_Y; froxel < (z + 1) * TILES_X * TILES_Y; froxel++) {
+                const Bounds &bounds = m_froxels[froxel];
+                glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+                glm::vec3 offset = closest - center;
+                if (glm::dot(offset, offset) <= range * range) {
+                    m_hits.push_back({froxel, index});
+                }
+            }
+        }
+    }
+
+    // Counting sort of the hits into one list per froxel
+    m_grid.assign(TILES_X * TILES_Y * SLICES * 2, 0);
+    for (const auto &[froxel, light] : m_hits) {
+        m_grid[froxel * 2 + 1]++;
+    }
+    GLuint offset = 0;
+    for (int froxel = 0; froxel < TILES_X * TILES_Y * SLICES; froxel++) {
+        m_grid[froxel * 2] = offset;
+        offset += m_grid[froxel * 2 + 1];
+        m_grid[froxel * 2 + 1] = 0;
+    }
+    m_indices.resize(std::max<size_t>(m_hits.size(), 1));
+    for (const auto &[froxel, light] : m_hits) {
+        m_indices[m_grid[froxel * 2] + m_grid[froxel * 2 + 1]++] = light;
+    }
+
+    if (m_light_data.empty()) m_light_data.push_back(glm::vec4(0.f));
+    upload(m_light_buffer, m_light_data.data(), m_light_data.size() * sizeof(glm::vec4));
+    upload(m_grid_buffer, m_grid.data(), m_grid.size() * sizeof(GLuint));
+    upload(m_index_buffer, m_indices.data(), m_indices.size() * sizeof(GLuint));
+}
+
+void LightClusters::upload(GLuint buffer, const void *data, size_t bytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    // Orphaning the old storage lets the driver keep last frame's copy in flight
+    glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::resolveUniforms(GLuint program) {
+    const char *names[3] = {"light_data", "cluster_grid", "cluster_lights"};
+    for (int i = 0; i < 3; i++) {
+        m_u_textures[i] = glGetUniformLocation(program, names[i]);
+    }
+    m_u_dims = glGetUniformLocation(program, "cluster_dims");
+    m_u_slicing = glGetUniformLocation(program, "cluster_slicing");
+    m_u_directional_count = glGetUniformLocation(program, "directional_count");
+}
+
+void LightClusters::bind(int firstUnit) const {
+    GLuint textures[3] = {m_light_texture, m_grid_texture, m_index_texture};
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glUniform1i(m_u_textures[i], firstUnit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    float slice_scale = SLICES / std::log(m_far / m_near);
+    glUniform3i(m_u_dims, TILES_X, TILES_Y, SLICES);
+    glUniform2f(m_u_slicing, slice_scale, -std::log(m_near) * slice_scale);
+    glUniform1i(m_u_directional_count, m_directional_count);
+}
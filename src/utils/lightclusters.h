@@ -0,0 +1,69 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <utility>
+#include <vector>
+
+#include "scenedata.h"
+
+// Clustered forward lighting. The view frustum is split into a grid of froxels (screen tiles
+// times exponentially spaced depth slices); every frame each point/spot light is binned into
+// the froxels its range overlaps and the resulting per-froxel light lists are uploaded through
+// texture buffers. A fragment then only evaluates the lights of its own froxel. Directional
+// lights reach everything and are listed once, ahead of the others.
+class LightClusters
+{
+public:
+    static const int TILES_X = 16;
+    static const int TILES_Y = 9;
+    static const int SLICES = 24;
+
+    // Called with the context current
+    void init();
+    void destroy();
+
+    // Bins world space lights for the given camera and uploads the result.
+    // shadowLayers has one entry per light (see ShadowMaps::layers), or is empty.
+    void update(const std::vector<SceneLightData> &lights, const std::vector<int> &shadowLayers,
+                const glm::mat4 &view, float near, float far, float heightAngle, float aspect);
+
+    // Distance at which a light's contribution becomes negligible
+    static float lightRange(const SceneLightData &light, float far);
+
+    // Looks up the cluster uniforms of the program bind() will be used with
+    void resolveUniforms(GLuint program);
+    // Binds the three buffers to units firstUnit.. and sets the cluster uniforms of the current program
+    void bind(int firstUnit) const;
+
+private:
+    struct Bounds {
+        glm::vec3 min, max;
+    };
+
+    // View space bounds of every froxel, rebuilt only when the projection changes
+    void buildFroxels(float near, float far, float heightAngle, float aspect);
+    static void upload(GLuint buffer, const void *data, size_t bytes);
+
+    std::vector<Bounds> m_froxels;
+    float m_near = 0.f, m_far = 0.f, m_height_angle = 0.f, m_aspect = 0.f;
+
+    std::vector<glm::vec4> m_light_data;     // 4 texels per light
+    std::vector<GLuint> m_grid;              // Offset and count per froxel
+    std::vector<GLuint> m_indices;           // Light lists of all froxels back to back
+    std::vector<std::pair<int, int>> m_hits; // (froxel, light) pairs before sorting
+    int m_directional_count = 0;
+
+    GLuint m_light_buffer = 0, m_light_texture = 0;
+    GLuint m_grid_buffer = 0, m_grid_texture = 0;
+    GLuint m_index_buffer = 0, m_index_texture = 0;
+
+    // Locations in the program passed to resolveUniforms
+    GLint m_u_textures[3] = {-1, -1, -1};
+    GLint m_u_dims = -1, m_u_slicing = -1, m_u_directional_count = -1;
+};
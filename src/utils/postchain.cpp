@@ -0,0 +1,139 @@
+#include "postchain.h"
+#include "shaderloader.h"
+
+#include <algorithm>
+#include <iostream>
+
+void PostChain::destroy() {
+    for (auto &[key, program] : m_programs) {
+        if (program) glDeleteProgram(program);
+    }
+    m_programs.clear();
+    m_uniforms.clear();
+    m_stale.clear();
+}
+
+void PostChain::reload() {
+    for (auto &[key, program] : m_programs) {
+        m_stale.insert(key);
+    }
+}
+
+void PostChain::addPass(Pass pass) {
+    m_passes.push_back(std::move(pass));
+}
+
+void PostChain::setOrder(const std::vector<std::string> &names) {
+    auto rank = [&](const Pass &pass) {
+        auto it = std::find(names.begin(), names.end(), pass.name);
+        return it == names.end() ? int(names.size()) : int(it - names.begin());
+    };
+    std::stable_sort(m_passes.begin(), m_passes.end(), [&](const Pass &a, const Pass &b) {
+        return rank(a) < rank(b);
+    });
+}
+
+GLint PostChain::uniform(GLuint program, const std::string &name) {
+    std::unordered_map<std::string, GLint> &locations = m_uniforms[program];
+    auto cached = locations.find(name);
+    if (cached != locations.end()) {
+        return cached->second;
+    }
+    GLint location = glGetUniformLocation(program, name.c_str());
+    locations[name] = location;
+    return location;
+}
+
+std::vector<std::string> PostChain::order() const {
+    std::vector<std::string> names;
+    for (const Pass &pass : m_passes) {
+        names.push_back(pass.name);
+    }
+    return names;
+}
+
+void PostChain::declare(RenderGraph &graph, const std::string &scene, const std::string &target, GLuint fullscreenVAO) {
+    std::vector<const Pass *> stages;
+    std::vector<std::string> inputs = {scene};
+    for (const Pass &pass : m_passes) {
+        if (pass.enabled && !pass.enabled()) continue;
+        if (pass.declare) pass.declare(graph, scene);
+        if (pass.stagePath.isEmpty()) continue;
+        stages.push_back(&pass);
+        inputs.insert(inputs.end(), pass.stageInputs.begin(), pass.stageInputs.end());
+    }
+
+    graph.addPass("composite", inputs, {target}, [this, stages, scene, target, fullscreenVAO](RenderGraph &graph) {
+        // Fullscreen passes never need depth
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        GLuint program = fusedProgram(stages);
+        if (program) {
+            glUseProgram(program);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(scene));
+            glUniform1i(uniform(program, "scene"), 0);
+            int scene_width, scene_height, target_width, target_height;
+            graph.size(scene, scene_width, scene_height);
+            graph.size(target, target_width, target_height);
+            glUniform1i(uniform(program, "upscale"), scene_width != target_width || scene_height != target_height);
+            for (const Pass *stage : stages) {
+                if (stage->setUniforms) stage->setUniforms(program, graph);
+            }
+
+            glBindVertexArray(fullscreenVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+            glUseProgram(0);
+        }
+
+        glEnable(GL_DEPTH_TEST);
+    });
+}
+
+GLuint PostChain::fusedProgram(const std::vector<const Pass *> &stages) {
+    std::string key;
+    for (const Pass *stage : stages) {
+        key += stage->name + ",";
+    }
+    auto cached = m_programs.find(key);
+    bool stale = m_stale.erase(key) > 0;
+    if (cached != m_programs.end() && !stale) {
+        return cached->second;
+    }
+
+    GLuint program = 0;
+    try {
+        std::string code = "#version 330 core\n"
+                           "in vec3 uv;\n"
+                           "out vec4 fragColor;\n"
+                           "uniform sampler2D scene;\n";
+        code += ShaderLoader::readFile(":/resources/shaders/post/common.glsl");
+        for (const Pass *stage : stages) {
+            code += ShaderLoader::readFile(stage->stagePath);
+        }
+
+        code += "void main() {\n"
+                "    vec3 color = sceneColor(uv.xy);\n";
+        for (const Pass *stage : stages) {
+            code += "    color = " + stage->name + "Stage(color, uv.xy);\n";
+        }
+        code += "    fragColor = vec4(color, 1.0);\n"
+                "}\n";
+
+        program = ShaderLoader::createShaderProgramFromSource(ShaderLoader::readFile(":/resources/shaders/bloom.vert"), code);
+    } catch (const std::runtime_error &e) {
+        // Cached as 0 so a broken combination isn't recompiled every frame
+        std::cerr << "[PostChain] Failed to build composite \"" << key << "\": " << e.what() << std::endl;
+    }
+
+    if (stale) {
+        // Reloads keep the last program that worked
+        if (!program) return cached->second;
+        glDeleteProgram(cached->second);
+        m_uniforms.erase(cached->second);
+    }
+    m_programs[key] = program;
+    return program;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <QString>
+
+#include "rendergraph.h"
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Post-processing passes, run in an order that can be changed at runtime.
+// A pass may add render graph passes producing its own targets (declare) and may contribute a
+// per-pixel stage to the final composite. All stages of the enabled passes are fused into one generated fragment
+// shader, so e.g. tone mapping, grading, vignette and grain cost a single fullscreen draw.
+class PostChain
+{
+public:
+    struct Pass {
+        std::string name;
+        std::function<bool()> enabled;
+        // Optional, adds the graph passes rendering the pass's intermediate targets from scene
+        std::function<void(RenderGraph &graph, const std::string &scene)> declare;
+        // Optional GLSL file defining vec3 <name>Stage(vec3 color, vec2 uv) plus its uniforms
+        QString stagePath;
+        // Graph resources the stage samples
+        std::vector<std::string> stageInputs;
+        // Called with the composite bound, sets the stage's uniforms and textures
+        std::function<void(GLuint program, RenderGraph &graph)> setUniforms;
+    };
+
+    // Called on exit with the context current
+    void destroy();
+    // Rebuilds each composite from its files the next time it is used. A composite that
+    // no longer compiles keeps its previous program.
+    void reload();
+
+    void addPass(Pass pass);
+    // Reorders the passes; names that aren't listed keep their relative order after the listed ones
+    void setOrder(const std::vector<std::string> &names);
+    std::vector<std::string> order() const;
+
+    // Location of a uniform in one of the fused programs, for setUniforms. Looked up from the
+    // driver once per program, the composite's program changes with the enabled stages.
+    GLint uniform(GLuint program, const std::string &name);
+
+    // Declares every enabled pass, then a composite drawing scene through the fused stages into target.
+    // A scene smaller than target is upscaled in the composite.
+    void declare(RenderGraph &graph, const std::string &scene, const std::string &target, GLuint fullscreenVAO);
+
+private:
+    GLuint fusedProgram(const std::vector<const Pass *> &stages);
+
+    std::vector<Pass> m_passes;
+    // One program per combination of stages, keyed by their names in order
+    std::map<std::string, GLuint> m_programs;
+    std::set<std::string> m_stale;
+    std::unordered_map<GLuint, std::unordered_map<std::string, GLint>> m_uniforms;
+};
@@ -0,0 +1,298 @@
+#include "rendergraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Textures unused for this many frames are deleted
+const int MAX_IDLE_FRAMES = 30;
+
+bool hasStencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+bool isDepthFormat(GLenum format) {
+    return hasStencil(format) || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+}
+
+// Pixel format and type for allocating a depth texture without data
+void depthTransfer(GLenum format, GLenum &pixelFormat, GLenum &type) {
+    switch (format) {
+    case GL_DEPTH24_STENCIL8:  pixelFormat = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; break;
+    case GL_DEPTH32F_STENCIL8: pixelFormat = GL_DEPTH_STENCIL; type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV; break;
+    case GL_DEPTH_COMPONENT32F: pixelFormat = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+    default:                   pixelFormat = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; break;
+    }
+}
+
+}
+
+void RenderGraph::destroy() {
+    for (auto &[attachments, fbo] : m_framebuffers) {
+        glDeleteFramebuffers(1, &fbo);
+    }
+    m_framebuffers.clear();
+    for (Texture &texture : m_textures) {
+        glDeleteTextures(1, &texture.name);
+    }
+    m_textures.clear();
+}
+
+void RenderGraph::beginFrame(int width, int height) {
+    m_width = width;
+    m_height = height;
+    m_resources.clear();
+    m_lookup.clear();
+    m_passes.clear();
+}
+
+void RenderGraph::createTexture(const std::string &name, GLenum format, int width, int height) {
+    Resource resource;
+    resource.name = name;
+    resource.format = format;
+    resource.width = std::max(width, 1);
+    resource.height = std::max(height, 1);
+    m_lookup[name] = m_resources.size();
+    m_resources.push_back(resource);
+}
+
+void RenderGraph::importFramebuffer(const std::string &name, GLuint fbo, int width, int height) {
+    Resource resource;
+    resource.name = name;
+    resource.width = width;
+    resource.height = height;
+    resource.fbo = fbo;
+    resource.imported = true;
+    m_lookup[name] = m_resources.size();
+    m_resources.push_back(resource);
+}
+
+void RenderGraph::importTexture(const std::string &name, GLuint texture, GLenum format, int width, int height) {
+    Resource resource;
+    resource.name = name;
+    resource.format = format;
+    resource.width = width;
+    resource.height = height;
+    resource.texture = texture;
+    resource.imported = true;
+    m_lookup[name] = m_resources.size();
+    m_resources.push_back(resource);
+}
+
+void RenderGraph::addPass(const std::string &name, std::vector<std::string> inputs, std::vector<std::string> outputs,
+                          Execute execute, bool bindOutputs) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    pass.bindOutputs = bindOutputs;
+    for (const std::string &input : inputs) {
+        int resource = find(input);
+        if (resource >= 0) pass.inputs.push_back(resource);
+    }
+    for (const std::string &output : outputs) {
+        int resource = find(output);
+        if (resource >= 0) pass.outputs.push_back(resource);
+    }
+    m_passes.push_back(std::move(pass));
+}
+
+bool RenderGraph::has(const std::string &name) const {
+    return m_lookup.count(name) > 0;
+}
+
+void RenderGraph::size(const std::string &name, int &width, int &height) const {
+    int resource = find(name);
+    width = resource < 0 ? 0 : m_resources[resource].width;
+    height = resource < 0 ? 0 : m_resources[resource].height;
+}
+
+GLuint RenderGraph::texture(const std::string &name) const {
+    int resource = find(name);
+    return resource < 0 ? 0 : m_resources[resource].texture;
+}
+
+int RenderGraph::find(const std::string &name) const {
+    auto it = m_lookup.find(name);
+    if (it == m_lookup.end()) {
+        std::cerr << "[RenderGraph] Unknown resource " << name << std::endl;
+        return -1;
+    }
+    return it->second;
+}
+
+void RenderGraph::execute() {
+    // Walk backwards from the imported targets: a pass is needed if anything needed reads what it writes
+    std::vector<bool> needed_resources(m_resources.size(), false);
+    std::vector<bool> kept(m_passes.size(), false);
+    for (int p = m_passes.size() - 1; p >= 0; p--) {
+        for (int output : m_passes[p].outputs) {
+            if (m_resources[output].imported || needed_resources[output]) kept[p] = true;
+        }
+        if (!kept[p]) continue;
+        for (int input : m_passes[p].inputs) {
+            needed_resources[input] = true;
+        }
+    }
+
+    for (int p = 0; p < m_passes.size(); p++) {
+        if (!kept[p]) continue;
+        for (int resource : m_passes[p].inputs) m_resources[resource].lastUse = p;
+        for (int resource : m_passes[p].outputs) m_resources[resource].lastUse = p;
+    }
+
+    for (Texture &texture : m_textures) {
+        texture.busy = false;
+        texture.idleFrames++;
+    }
+
+    for (int p = 0; p < m_passes.size(); p++) {
+        if (!kept[p]) continue;
+        Pass &pass = m_passes[p];
+
+        // Memory is assigned on first write...
+        for (int output : pass.outputs) {
+            Resource &resource = m_resources[output];
+            if (!resource.imported && resource.pooled < 0) {
+                resource.pooled = acquire(resource);
+                resource.texture = m_textures[resource.pooled].name;
+            }
+        }
+
+        if (pass.bindOutputs) {
+            bindOutputs(pass);
+        }
+        pass.execute(*this);
+
+        // ...and handed back after the last use, so later targets of the same kind alias it
+        auto release = [&](int index) {
+            Resource &resource = m_resources[index];
+            if (resource.lastUse == p && resource.pooled >= 0) {
+                m_textures[resource.pooled].busy = false;
+            }
+        };
+        for (int input : pass.inputs) release(input);
+        for (int output : pass.outputs) release(output);
+    }
+
+    evict();
+}
+
+int RenderGraph::acquire(const Resource &resource) {
+    for (int i = 0; i < m_textures.size(); i++) {
+        Texture &texture = m_textures[i];
+        if (!texture.busy && texture.format == resource.format
+            && texture.width == resource.width && texture.height == resource.height) {
+            texture.busy = true;
+            texture.idleFrames = 0;
+            return i;
+        }
+    }
+
+    Texture texture;
+    texture.format = resource.format;
+    texture.width = resource.width;
+    texture.height = resource.height;
+    texture.busy = true;
+
+    glGenTextures(1, &texture.name);
+    glBindTexture(GL_TEXTURE_2D, texture.name);
+    if (isDepthFormat(resource.format)) {
+        GLenum pixel_format, type;
+        depthTransfer(resource.format, pixel_format, type);
+        glTexImage2D(GL_TEXTURE_2D, 0, resource.format, resource.width, resource.height, 0,
+                     pixel_format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, resource.format, resource.width, resource.height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    // Clamp to avoid filtering using repeated textures
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_textures.push_back(texture);
+    return m_textures.size() - 1;
+}
+
+void RenderGraph::bindOutputs(const Pass &pass) {
+    if (pass.outputs.empty()) return;
+
+    const Resource &first = m_resources[pass.outputs[0]];
+    if (first.fbo) {
+        glBindFramebuffer(GL_FRAMEBUFFER, first.fbo);
+        glViewport(0, 0, first.width, first.height);
+        return;
+    }
+
+    std::vector<GLuint> attachments;
+    for (int output : pass.outputs) {
+        attachments.push_back(m_resources[output].texture);
+    }
+
+    auto cached = m_framebuffers.find(attachments);
+    GLuint fbo;
+    if (cached != m_framebuffers.end()) {
+        fbo = cached->second;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    } else {
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+        std::vector<GLenum> draw_buffers;
+        for (int output : pass.outputs) {
+            const Resource &resource = m_resources[output];
+            if (isDepthFormat(resource.format)) {
+                GLenum attachment = hasStencil(resource.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+            } else {
+                GLenum attachment = GL_COLOR_ATTACHMENT0 + draw_buffers.size();
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+                draw_buffers.push_back(attachment);
+            }
+        }
+        // Tells opengl how many color buffers there are
+        if (draw_buffers.empty()) {
+            glDrawBuffer(GL_NONE);
+        } else {
+            glDrawBuffers(draw_buffers.size(), draw_buffers.data());
+        }
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "[RenderGraph] Framebuffer for pass " << pass.name << " is not complete" << std::endl;
+        }
+        m_framebuffers[attachments] = fbo;
+    }
+    glViewport(0, 0, first.width, first.height);
+}
+
+void RenderGraph::evict() {
+    std::vector<GLuint> deleted;
+    for (int i = m_textures.size() - 1; i >= 0; i--) {
+        if (m_textures[i].idleFrames > MAX_IDLE_FRAMES) {
+            deleted.push_back(m_textures[i].name);
+            glDeleteTextures(1, &m_textures[i].name);
+            m_textures.erase(m_textures.begin() + i);
+        }
+    }
+    if (deleted.empty()) return;
+
+    // Resource indices into the pool are only used within a frame, so shifting them is fine
+    for (Resource &resource : m_resources) {
+        resource.pooled = -1;
+    }
+    for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+        bool stale = std::any_of(it->first.begin(), it->first.end(), [&](GLuint name) {
+            return std::find(deleted.begin(), deleted.end(), name) != deleted.end();
+        });
+        if (stale) {
+            glDeleteFramebuffers(1, &it->second);
+            it = m_framebuffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A small frame graph. Every frame the renderer declares its targets and the passes that read
+// and write them, then executes the graph. Passes whose results nobody uses are skipped, and
+// transient targets whose lifetimes don't overlap share the same texture. Textures are pooled
+// across frames and dropped once they go unused, which also takes care of resizes.
+class RenderGraph
+{
+public:
+    using Execute = std::function<void(RenderGraph &graph)>;
+
+    // Called on exit with the context current
+    void destroy();
+
+    // Starts declaring a new frame; width/height are the size of the full resolution targets
+    void beginFrame(int width, int height);
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // Transient texture, only valid between the first and last pass using it. Depth formats
+    // are attached as depth (depth/stencil if they have stencil), everything else as color.
+    void createTexture(const std::string &name, GLenum format, int width, int height);
+    // A framebuffer owned outside the graph, e.g. the widget's. Passes writing it count as used.
+    void importFramebuffer(const std::string &name, GLuint fbo, int width, int height);
+    // A texture owned outside the graph that lives across frames, e.g. a history buffer.
+    // Like imported framebuffers, writing it counts as used.
+    void importTexture(const std::string &name, GLuint texture, GLenum format, int width, int height);
+
+    // Outputs are bound as the pass's render targets (in order) with a matching viewport,
+    // unless bindOutputs is false, e.g. for compute passes writing images
+    void addPass(const std::string &name, std::vector<std::string> inputs, std::vector<std::string> outputs,
+                 Execute execute, bool bindOutputs = true);
+
+    // Culls, allocates and runs the declared passes in declaration order
+    void execute();
+
+    // The texture behind a resource, valid inside the passes that use it
+    GLuint texture(const std::string &name) const;
+    // Whether a resource was declared this frame
+    bool has(const std::string &name) const;
+    void size(const std::string &name, int &width, int &height) const;
+
+private:
+    struct Resource {
+        std::string name;
+        GLenum format = 0;
+        int width = 0, height = 0;
+        GLuint fbo = 0;        // Imported framebuffers only
+        GLuint texture = 0;    // Imported, or the pooled texture while alive
+        bool imported = false;
+        int pooled = -1;       // Index into m_textures while alive
+        int lastUse = -1;      // Last pass reading or writing it
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<int> inputs, outputs;
+        Execute execute;
+        bool bindOutputs;
+    };
+
+    struct Texture {
+        GLuint name;
+        GLenum format;
+        int width, height;
+        bool busy = false;
+        int idleFrames = 0;
+    };
+
+    int find(const std::string &name) const;
+    int acquire(const Resource &resource);
+    void bindOutputs(const Pass &pass);
+    void evict();
+
+    int m_width = 0, m_height = 0;
+    std::vector<Resource> m_resources;
+    std::unordered_map<std::string, int> m_lookup;
+    std::vector<Pass> m_passes;
+
+    // Persistent pool of textures and of framebuffers built from them
+    std::vector<Texture> m_textures;
+    std::map<std::vector<GLuint>, GLuint> m_framebuffers;
+};
@@ -0,0 +1,74 @@
+#include "resolutionscaler.h"
+
+#include <algorithm>
+
+namespace {
+
+const float SCALE_STEP = 0.125f;
+// Frames to wait after a change before judging the new scale
+const int COOLDOWN_FRAMES = 30;
+// Weight of the newest sample in the running average
+const float SMOOTHING = 0.1f;
+
+}
+
+void ResolutionScaler::init() {
+    glGenQueries(QUERY_COUNT, m_queries);
+    reset();
+}
+
+void ResolutionScaler::destroy() {
+    glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+void ResolutionScaler::reset() {
+    m_scale = maxScale;
+    m_average_ms = 0.f;
+    m_cooldown = COOLDOWN_FRAMES;
+}
+
+void ResolutionScaler::beginFrame() {
+    // The oldest query is about to be reused; only take its result if it is already there
+    if (m_pending[m_current]) {
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[m_current], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(m_queries[m_current], GL_QUERY_RESULT, &elapsed);
+            update(elapsed / 1e6f);
+        }
+        m_pending[m_current] = false;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_current]);
+    m_timing = true;
+}
+
+void ResolutionScaler::endFrame() {
+    if (!m_timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_current] = true;
+    m_current = (m_current + 1) % QUERY_COUNT;
+    m_timing = false;
+}
+
+void ResolutionScaler::update(float gpuMs) {
+    m_average_ms = m_average_ms == 0.f ? gpuMs : m_average_ms + SMOOTHING * (gpuMs - m_average_ms);
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return;
+    }
+
+    // Asymmetric thresholds so the scale doesn't flip between two steps
+    float scale = m_scale;
+    if (m_average_ms > targetMs * 1.05f) {
+        scale = std::max(m_scale - SCALE_STEP, minScale);
+    } else if (m_average_ms < targetMs * 0.75f) {
+        scale = std::min(m_scale + SCALE_STEP, maxScale);
+    }
+
+    if (scale != m_scale) {
+        m_scale = scale;
+        m_cooldown = COOLDOWN_FRAMES;
+    }
+}
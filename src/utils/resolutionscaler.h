@@ -0,0 +1,45 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+// Picks the scene's render scale from measured GPU frame times. Frames are timed with a small
+// ring of GL_TIME_ELAPSED queries that are only read once their results are available, so the
+// measurement never stalls the pipeline. The scale moves in fixed steps with a cooldown, which
+// keeps the number of distinct target sizes (and reallocations) small.
+class ResolutionScaler
+{
+public:
+    // Called with the context current
+    void init();
+    void destroy();
+
+    // Bracket the GPU work of a frame
+    void beginFrame();
+    void endFrame();
+
+    // Fraction of the output resolution the scene should render at
+    float scale() const { return m_scale; }
+    // Drops back to full resolution, e.g. when the feature is switched off
+    void reset();
+
+    float targetMs = 16.6f;
+    float minScale = 0.5f;
+    float maxScale = 1.f;
+
+private:
+    void update(float gpuMs);
+
+    static const int QUERY_COUNT = 4;
+    GLuint m_queries[QUERY_COUNT] = {};
+    bool m_pending[QUERY_COUNT] = {};
+    int m_current = 0;
+    bool m_timing = false;
+
+    float m_average_ms = 0.f;
+    int m_cooldown = 0;
+    float m_scale = 1.f;
+};
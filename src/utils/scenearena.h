@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator backing the scene graph. Objects are packed into large blocks in the order
+// they are parsed and everything is released at once when the arena goes away.
+class SceneArena {
+public:
+    explicit SceneArena(size_t blockSize = 64 * 1024) : m_block_size(blockSize) {}
+
+    ~SceneArena() {
+        // Only types that own memory (e.g. primitives with file names) register a destructor
+        for (auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it) {
+            (*it)();
+        }
+        for (char *block : m_blocks) {
+            ::operator delete(block);
+        }
+    }
+
+    SceneArena(const SceneArena &) = delete;
+    SceneArena &operator=(const SceneArena &) = delete;
+
+    // Returns count value-initialized (i.e. zeroed) objects laid out contiguously
+    template <typename T>
+    T *allocate(int count) {
+        if (count <= 0) {
+            return nullptr;
+        }
+
+        T *objects = static_cast<T *>(allocateBytes(sizeof(T) * count, alignof(T)));
+        for (int i = 0; i < count; i++) {
+            new (objects + i) T();
+        }
+
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            m_destructors.push_back([objects, count]() {
+                for (int i = 0; i < count; i++) {
+                    objects[i].~T();
+                }
+            });
+        }
+        return objects;
+    }
+
+private:
+    void *allocateBytes(size_t size, size_t align) {
+        size_t offset = (m_used + align - 1) & ~(align - 1);
+        if (m_blocks.empty() || offset + size > m_current_size) {
+            // Oversized requests get a block of their own
+            m_current_size = std::max(m_block_size, size);
+            m_blocks.push_back(static_cast<char *>(::operator new(m_current_size)));
+            offset = 0;
+        }
+        m_used = offset + size;
+        return m_blocks.back() + offset;
+    }
+
+    size_t m_block_size;
+    size_t m_current_size = 0;
+    size_t m_used = 0;
+    std::vector<char *> m_blocks;
+    std::vector<std::function<void()>> m_destructors;
+};
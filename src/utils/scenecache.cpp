@@ -0,0 +1,289 @@
+#include "scenecache.h"
+#include "cachefile.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+const char MAGIC[4] = {'F', 'L', 'S', 'C'};
+const uint32_t VERSION = 2;
+
+// Strings are stored once in a table at the end of the file
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct FileMapData {
+    uint32_t isUsed;
+    float repeatU;
+    float repeatV;
+    StringRef filename;
+};
+
+struct ShapeData {
+    PrimitiveType type;
+    glm::mat4 ctm;
+
+    SceneColor cAmbient;
+    SceneColor cDiffuse;
+    SceneColor cSpecular;
+    float shininess;
+    SceneColor cReflective;
+    SceneColor cTransparent;
+    float ior;
+    float blend;
+    SceneColor cEmissive;
+    FileMapData textureMap;
+    FileMapData bumpMap;
+
+    StringRef meshfile;
+};
+
+// Slices of the template sections belonging to one template
+struct TemplateData {
+    uint32_t firstShape, numShapes;
+    uint32_t firstLight, numLights;
+    uint32_t firstInstance, numInstances;
+};
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    // Used to reject snapshots whose scene file has been edited since
+    int64_t sourceSize;
+    int64_t sourceModified;
+
+    uint32_t numLights;
+    uint32_t numShapes;
+    uint32_t numTemplates;
+    uint32_t numTemplateLights;
+    uint32_t numTemplateShapes;
+    uint32_t numInstances;
+    uint32_t stringBytes;
+
+    SceneGlobalData globalData;
+    SceneCameraData cameraData;
+};
+
+static_assert(std::is_trivially_copyable_v<SceneLightData>, "lights are copied as raw bytes");
+static_assert(std::is_trivially_copyable_v<ShapeData>, "shapes are copied as raw bytes");
+
+StringRef addString(std::string &table, const std::string &str) {
+    StringRef ref = {uint32_t(table.size()), uint32_t(str.size())};
+    table += str;
+    return ref;
+}
+
+FileMapData packFileMap(std::string &table, const SceneFileMap &map) {
+    return {map.isUsed, map.repeatU, map.repeatV, addString(table, map.filename)};
+}
+
+ShapeData packShape(std::string &table, const RenderShapeData &object) {
+    const ScenePrimitive &prim = object.primitive;
+    const SceneMaterial &mat = prim.material;
+    ShapeData shape{};
+
+    shape.type = prim.type;
+    shape.ctm = object.ctm;
+    shape.cAmbient = mat.cAmbient;
+    shape.cDiffuse = mat.cDiffuse;
+    shape.cSpecular = mat.cSpecular;
+    shape.shininess = mat.shininess;
+    shape.cReflective = mat.cReflective;
+    shape.cTransparent = mat.cTransparent;
+    shape.ior = mat.ior;
+    shape.blend = mat.blend;
+    shape.cEmissive = mat.cEmissive;
+    shape.textureMap = packFileMap(table, mat.textureMap);
+    shape.bumpMap = packFileMap(table, mat.bumpMap);
+    shape.meshfile = addString(table, prim.meshfile);
+    return shape;
+}
+
+}
+
+std::string SceneCache::cachePath(const std::string &scenePath) {
+    return CacheFile::path(QString::fromStdString(scenePath), "scenes", ".flsc").toStdString();
+}
+
+bool SceneCache::write(const std::string &filepath, const std::string &scenePath, const RenderData &renderData) {
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    CacheFile::stamp(QString::fromStdString(scenePath), header.sourceSize, header.sourceModified);
+    header.numLights = renderData.lights.size();
+    header.numShapes = renderData.shapes.size();
+    header.globalData = renderData.globalData;
+    header.cameraData = renderData.cameraData;
+
+    std::string strings;
+    std::vector<ShapeData> shapes;
+    shapes.reserve(renderData.shapes.size());
+    for (const RenderShapeData &object : renderData.shapes) {
+        shapes.push_back(packShape(strings, object));
+    }
+
+    // Template contents are concatenated, each template records its slice
+    std::vector<TemplateData> templates;
+    std::vector<SceneLightData> templateLights;
+    std::vector<ShapeData> templateShapes;
+    std::vector<glm::mat4> instances;
+    for (const RenderTemplateData &templ : renderData.templates) {
+        templates.push_back({uint32_t(templateShapes.size()), uint32_t(templ.shapes.size()),
+                             uint32_t(templateLights.size()), uint32_t(templ.lights.size()),
+                             uint32_t(instances.size()), uint32_t(templ.instances.size())});
+        for (const RenderShapeData &object : templ.shapes) {
+            templateShapes.push_back(packShape(strings, object));
+        }
+        templateLights.insert(templateLights.end(), templ.lights.begin(), templ.lights.end());
+        instances.insert(instances.end(), templ.instances.begin(), templ.instances.end());
+    }
+    header.numTemplates = templates.size();
+    header.numTemplateLights = templateLights.size();
+    header.numTemplateShapes = templateShapes.size();
+    header.numInstances = instances.size();
+    header.stringBytes = strings.size();
+
+    // QSaveFile only replaces the old snapshot once everything has been written
+    QDir().mkpath(QFileInfo(QString::fromStdString(filepath)).absolutePath());
+    QSaveFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cout << "could not write scene cache " << filepath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(renderData.lights.data()), renderData.lights.size() * sizeof(SceneLightData));
+    file.write(reinterpret_cast<const char *>(shapes.data()), shapes.size() * sizeof(ShapeData));
+    file.write(reinterpret_cast<const char *>(templates.data()), templates.size() * sizeof(TemplateData));
+    file.write(reinterpret_cast<const char *>(templateLights.data()), templateLights.size() * sizeof(SceneLightData));
+    file.write(reinterpret_cast<const char *>(templateShapes.data()), templateShapes.size() * sizeof(ShapeData));
+    file.write(reinterpret_cast<const char *>(instances.data()), instances.size() * sizeof(glm::mat4));
+    file.write(strings.data(), strings.size());
+    return file.commit();
+}
+
+bool SceneCache::read(const std::string &filepath, const std::string &scenePath, RenderData &renderData) {
+    QFile file(QString::fromStdString(filepath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    qint64 fileSize = file.size();
+    if (fileSize < qint64(sizeof(Header))) {
+        return false;
+    }
+    uchar *data = file.map(0, fileSize);
+    if (!data) {
+        return false;
+    }
+
+    Header header{};
+    memcpy(&header, data, sizeof(Header));
+
+    int64_t sourceSize, sourceModified;
+    CacheFile::stamp(QString::fromStdString(scenePath), sourceSize, sourceModified);
+    uint64_t expectedSize = sizeof(Header)
+                            + uint64_t(header.numLights) * sizeof(SceneLightData)
+                            + uint64_t(header.numShapes) * sizeof(ShapeData)
+                            + uint64_t(header.numTemplates) * sizeof(TemplateData)
+                            + uint64_t(header.numTemplateLights) * sizeof(SceneLightData)
+                            + uint64_t(header.numTemplateShapes) * sizeof(ShapeData)
+                            + uint64_t(header.numInstances) * sizeof(glm::mat4)
+                            + header.stringBytes;
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.sourceSize != sourceSize || header.sourceModified != sourceModified
+        || expectedSize != uint64_t(fileSize)) {
+        file.unmap(data);
+        return false;
+    }
+
+    const uchar *lights = data + sizeof(Header);
+    const uchar *shapes = lights + header.numLights * sizeof(SceneLightData);
+    const uchar *templates = shapes + header.numShapes * sizeof(ShapeData);
+    const uchar *templateLights = templates + header.numTemplates * sizeof(TemplateData);
+    const uchar *templateShapes = templateLights + header.numTemplateLights * sizeof(SceneLightData);
+    const uchar *instances = templateShapes + header.numTemplateShapes * sizeof(ShapeData);
+    const char *strings = reinterpret_cast<const char *>(instances + header.numInstances * sizeof(glm::mat4));
+    auto getString = [&](StringRef ref) {
+        if (uint64_t(ref.offset) + ref.length > header.stringBytes) return std::string();
+        return std::string(strings + ref.offset, ref.length);
+    };
+    auto unpackFileMap = [&](const FileMapData &packed, SceneFileMap &map) {
+        map.isUsed = packed.isUsed;
+        map.repeatU = packed.repeatU;
+        map.repeatV = packed.repeatV;
+        map.filename = getString(packed.filename);
+    };
+
+    renderData.globalData = header.globalData;
+    renderData.cameraData = header.cameraData;
+
+    renderData.lights.resize(header.numLights);
+    memcpy(renderData.lights.data(), lights, header.numLights * sizeof(SceneLightData));
+
+    auto unpackShape = [&](const uchar *packed, RenderShapeData &object) {
+        ShapeData shape;
+        memcpy(&shape, packed, sizeof(ShapeData));
+
+        ScenePrimitive &prim = object.primitive;
+        SceneMaterial &mat = prim.material;
+        mat.clear();
+
+        prim.type = shape.type;
+        object.ctm = shape.ctm;
+        mat.cAmbient = shape.cAmbient;
+        mat.cDiffuse = shape.cDiffuse;
+        mat.cSpecular = shape.cSpecular;
+        mat.shininess = shape.shininess;
+        mat.cReflective = shape.cReflective;
+        mat.cTransparent = shape.cTransparent;
+        mat.ior = shape.ior;
+        mat.blend = shape.blend;
+        mat.cEmissive = shape.cEmissive;
+        unpackFileMap(shape.textureMap, mat.textureMap);
+        unpackFileMap(shape.bumpMap, mat.bumpMap);
+        prim.meshfile = getString(shape.meshfile);
+    };
+
+    renderData.shapes.clear();
+    renderData.shapes.resize(header.numShapes);
+    for (int i = 0; i < header.numShapes; i++) {
+        unpackShape(shapes + i * sizeof(ShapeData), renderData.shapes[i]);
+    }
+
+    renderData.templates.clear();
+    renderData.templates.resize(header.numTemplates);
+    for (int i = 0; i < header.numTemplates; i++) {
+        TemplateData packed;
+        memcpy(&packed, templates + i * sizeof(TemplateData), sizeof(TemplateData));
+        if (uint64_t(packed.firstShape) + packed.numShapes > header.numTemplateShapes
+            || uint64_t(packed.firstLight) + packed.numLights > header.numTemplateLights
+            || uint64_t(packed.firstInstance) + packed.numInstances > header.numInstances) {
+            renderData = RenderData{};
+            file.unmap(data);
+            return false;
+        }
+
+        RenderTemplateData &templ = renderData.templates[i];
+        templ.shapes.resize(packed.numShapes);
+        for (int k = 0; k < packed.numShapes; k++) {
+            unpackShape(templateShapes + (packed.firstShape + k) * sizeof(ShapeData), templ.shapes[k]);
+        }
+        templ.lights.resize(packed.numLights);
+        memcpy(templ.lights.data(), templateLights + packed.firstLight * sizeof(SceneLightData), packed.numLights * sizeof(SceneLightData));
+        templ.instances.resize(packed.numInstances);
+        memcpy(templ.instances.data(), instances + packed.firstInstance * sizeof(glm::mat4), packed.numInstances * sizeof(glm::mat4));
+    }
+
+    file.unmap(data);
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "sceneparser.h"
+
+#include <string>
+
+// Compiled scene snapshots: the flattened RenderData of a scene file stored as one binary blob.
+// Loading one is a single mmap plus a few copies, skipping JSON parsing and graph traversal.
+class SceneCache {
+public:
+    // Where the snapshot of a scene file lives: the user's cache directory, named by a hash of its path
+    static std::string cachePath(const std::string &scenePath);
+
+    // Writes the flattened scene. Shape/GL handles are runtime state and aren't stored.
+    // @param scenePath   The scene file renderData was loaded from, used to detect stale snapshots.
+    static bool write(const std::string &filepath, const std::string &scenePath, const RenderData &renderData);
+
+    // Fills renderData from a snapshot. Returns false if it is missing, stale or malformed,
+    // in which case the scene should be parsed from JSON instead.
+    static bool read(const std::string &filepath, const std::string &scenePath, RenderData &renderData);
+};
@@ -160,10 +160,22 @@ struct SceneTransformation {
     glm::mat4 matrix;    // Only applicable when transforming by a custom matrix. This is that custom matrix.
 };
 
+// A contiguous run of objects allocated from the ScenefileReader's arena
+template <typename T>
+struct SceneSpan {
+    T *data = nullptr;
+    int size = 0;
+
+    T *begin() const { return data; }
+    T *end() const { return data + size; }
+    T &operator[](int i) const { return data[i]; }
+};
+
 // Struct which represents a node in the scene graph/tree, to be parsed by the student's `SceneParser`.
+// Nodes are stored contiguously by the ScenefileReader and refer to their children by index.
 struct SceneNode {
-    std::vector<SceneTransformation*> transformations; // Note the order of transformations described in lab 5
-    std::vector<ScenePrimitive*> primitives;
-    std::vector<SceneLight*> lights;
-    std::vector<SceneNode*> children;
+    SceneSpan<SceneTransformation> transformations; // Note the order of transformations described in lab 5
+    SceneSpan<ScenePrimitive> primitives;
+    SceneSpan<SceneLight> lights;
+    SceneSpan<int> children;
 };
@@ -24,31 +24,15 @@ ScenefileReader::ScenefileReader(const std::string &name) {
     memset(&m_cameraData, 0, sizeof(SceneCameraData));
     memset(&m_globalData, 0, sizeof(SceneGlobalData));
 
-    m_root = new SceneNode;
-
     m_templates.clear();
     m_nodes.clear();
 
-    m_nodes.push_back(m_root);
+    // Root node
+    m_nodes.emplace_back();
 }
 
 ScenefileReader::~ScenefileReader() {
-    // Delete all Scene Nodes
-    for (unsigned int node = 0; node < m_nodes.size(); node++) {
-        for (size_t i = 0; i < (m_nodes[node])->transformations.size(); i++)
-        {
-            delete (m_nodes[node])->transformations[i];
-        }
-        for (size_t i = 0; i < (m_nodes[node])->primitives.size(); i++)
-        {
-            delete (m_nodes[node])->primitives[i];
-        }
-        (m_nodes[node])->transformations.clear();
-        (m_nodes[node])->primitives.clear();
-        (m_nodes[node])->children.clear();
-        delete m_nodes[node];
-    }
-
+    // The nodes only hold spans into the arena, which frees the whole graph on its own
     m_nodes.clear();
     m_templates.clear();
 }
@@ -61,8 +45,21 @@ SceneCameraData ScenefileReader::getCameraData() const {
     return m_cameraData;
 }
 
-SceneNode *ScenefileReader::getRootNode() const {
-    return m_root;
+const SceneNode &ScenefileReader::getRootNode() const {
+    return m_nodes[0];
+}
+
+const std::vector<SceneNode> &ScenefileReader::getNodes() const {
+    return m_nodes;
+}
+
+std::vector<int> ScenefileReader::getTemplateNodes() const {
+    std::vector<int> nodes;
+    nodes.reserve(m_templates.size());
+    for (auto &[name, node] : m_templates) {
+        nodes.push_back(node);
+    }
+    return nodes;
 }
 
 // This is where it all goes down...
@@ -135,7 +132,7 @@ bool ScenefileReader::readJSON() {
 
     // Parse the groups
     if (scenefile.contains("groups")) {
-        if (!parseGroups(scenefile["groups"], m_root)) {
+        if (!parseGroups(scenefile["groups"], 0)) {
             return false;
         }
     }
@@ -202,7 +199,7 @@ bool ScenefileReader::parseGlobalData(const QJsonObject &globalData) {
 /**
  * Parse a Light and add a new CS123SceneLightData to m_lights.
  */
-bool ScenefileReader::parseLightData(const QJsonObject &lightData, SceneNode *node) {
+bool ScenefileReader::parseLightData(const QJsonObject &lightData, SceneLight *light) {
     QStringList requiredFields = {"type", "color"};
     QStringList optionalFields = {"name", "attenuationCoeff", "direction", "penumbra", "angle"};
     QStringList allFields = requiredFields + optionalFields;
@@ -219,11 +216,7 @@ bool ScenefileReader::parseLightData(const QJsonObject &lightData, SceneNode *no
         }
     }
 
-    // Create a default light
-    SceneLight *light = new SceneLight();
-    memset(light, 0, sizeof(SceneLight));
-    node->lights.push_back(light);
-
+    // Default light (the arena hands it out zeroed)
     light->dir = glm::vec4(0.f, 0.f, 0.f, 0.f);
     light->function = glm::vec3(1, 0, 0);
 
@@ -566,8 +559,8 @@ bool ScenefileReader::parseTemplateGroupData(const QJsonObject &templateGroup) {
         std::cout << "templateGroups cannot have the same" << std::endl;
     }
 
-    SceneNode *templateNode = new SceneNode;
-    m_nodes.push_back(templateNode);
+    int templateNode = m_nodes.size();
+    m_nodes.emplace_back();
     m_templates[templateGroup["name"].toString().toStdString()] = templateNode;
 
     return parseGroupData(templateGroup, templateNode);
@@ -577,7 +570,7 @@ bool ScenefileReader::parseTemplateGroupData(const QJsonObject &templateGroup) {
  * Parse a group object and create a new CS123SceneNode in m_nodes.
  * NAME OF NODE CANNOT REFERENCE TEMPLATE NODE
  */
-bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node) {
+bool ScenefileReader::parseGroupData(const QJsonObject &object, int node) {
     QStringList optionalFields = {"name", "translate", "rotate", "scale", "matrix", "lights", "primitives", "groups"};
     QStringList allFields = optionalFields;
     for (auto &field : object.keys()) {
@@ -587,6 +580,14 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
         }
     }
 
+    // Each list is allocated once at its final size so a node's data stays contiguous.
+    // Indexing m_nodes (rather than holding a pointer) stays valid while children are added.
+    int numTransformations = 0;
+    for (auto &field : {"translate", "rotate", "scale", "matrix"}) {
+        if (object.contains(field)) numTransformations++;
+    }
+    SceneSpan<SceneTransformation> transformations = {m_arena.allocate<SceneTransformation>(numTransformations), 0};
+
     // parse translation if defined
     if (object.contains("translate")) {
         if (!object["translate"].isArray()) {
@@ -604,13 +605,12 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             return false;
         }
 
-        SceneTransformation *translation = new SceneTransformation();
+        SceneTransformation *translation = &transformations.data[transformations.size++];
         translation->type = TransformationType::TRANSFORMATION_TRANSLATE;
         translation->translate.x = translateArray[0].toDouble();
         translation->translate.y = translateArray[1].toDouble();
         translation->translate.z = translateArray[2].toDouble();
 
-        node->transformations.push_back(translation);
     }
 
     // parse rotation if defined
@@ -630,14 +630,13 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             return false;
         }
 
-        SceneTransformation *rotation = new SceneTransformation();
+        SceneTransformation *rotation = &transformations.data[transformations.size++];
         rotation->type = TransformationType::TRANSFORMATION_ROTATE;
         rotation->rotate.x = rotateArray[0].toDouble();
         rotation->rotate.y = rotateArray[1].toDouble();
         rotation->rotate.z = rotateArray[2].toDouble();
         rotation->angle = rotateArray[3].toDouble() * M_PI / 180.f;
 
-        node->transformations.push_back(rotation);
     }
 
     // parse scale if defined
@@ -657,13 +656,12 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             return false;
         }
 
-        SceneTransformation *scale = new SceneTransformation();
+        SceneTransformation *scale = &transformations.data[transformations.size++];
         scale->type = TransformationType::TRANSFORMATION_SCALE;
         scale->scale.x = scaleArray[0].toDouble();
         scale->scale.y = scaleArray[1].toDouble();
         scale->scale.z = scaleArray[2].toDouble();
 
-        node->transformations.push_back(scale);
     }
 
     // parse matrix if defined
@@ -679,7 +677,7 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             return false;
         }
 
-        SceneTransformation *matrixTransformation = new SceneTransformation();
+        SceneTransformation *matrixTransformation = &transformations.data[transformations.size++];
         matrixTransformation->type = TransformationType::TRANSFORMATION_MATRIX;
 
         float *matrixPtr = glm::value_ptr(matrixTransformation->matrix);
@@ -709,9 +707,8 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             }
             rowIndex++;
         }
-
-        node->transformations.push_back(matrixTransformation);
     }
+    m_nodes[node].transformations = transformations;
 
     // parse lights if any
     if (object.contains("lights")) {
@@ -720,13 +717,15 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             return false;
         }
         QJsonArray lightsArray = object["lights"].toArray();
-        for (auto light : lightsArray) {
-            if (!light.isObject()) {
+        SceneSpan<SceneLight> lights = {m_arena.allocate<SceneLight>(lightsArray.size()), int(lightsArray.size())};
+        m_nodes[node].lights = lights;
+        for (int i = 0; i < lights.size; i++) {
+            if (!lightsArray[i].isObject()) {
                 std::cout << "light must be of type object" << std::endl;
                 return false;
             }
 
-            if (!parseLightData(light.toObject(), node)) {
+            if (!parseLightData(lightsArray[i].toObject(), &lights[i])) {
                 return false;
             }
         }
@@ -739,13 +738,15 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
             return false;
         }
         QJsonArray primitivesArray = object["primitives"].toArray();
-        for (auto primitive : primitivesArray) {
-            if (!primitive.isObject()) {
+        SceneSpan<ScenePrimitive> primitives = {m_arena.allocate<ScenePrimitive>(primitivesArray.size()), int(primitivesArray.size())};
+        m_nodes[node].primitives = primitives;
+        for (int i = 0; i < primitives.size; i++) {
+            if (!primitivesArray[i].isObject()) {
                 std::cout << "primitive must be of type object" << std::endl;
                 return false;
             }
 
-            if (!parsePrimitive(primitive.toObject(), node)) {
+            if (!parsePrimitive(primitivesArray[i].toObject(), &primitives[i])) {
                 return false;
             }
         }
@@ -761,13 +762,15 @@ bool ScenefileReader::parseGroupData(const QJsonObject &object, SceneNode *node)
     return true;
 }
 
-bool ScenefileReader::parseGroups(const QJsonValue &groups, SceneNode *parent) {
+bool ScenefileReader::parseGroups(const QJsonValue &groups, int parent) {
     if (!groups.isArray()) {
         std::cout << "groups must be of type array" << std::endl;
         return false;
     }
 
     QJsonArray groupsArray = groups.toArray();
+    SceneSpan<int> children = {m_arena.allocate<int>(groupsArray.size()), 0};
+    m_nodes[parent].children = children;
     for (auto group : groupsArray) {
         if (!group.isObject()) {
             std::cout << "group items must be of type object" << std::endl;
@@ -784,14 +787,16 @@ bool ScenefileReader::parseGroups(const QJsonValue &groups, SceneNode *parent) {
             // if its a reference to a template group append it
             std::string groupName = groupData["name"].toString().toStdString();
             if (m_templates.contains(groupName)) {
-                parent->children.push_back(m_templates[groupName]);
+                children.data[children.size++] = m_templates[groupName];
+                m_nodes[parent].children = children;
                 continue;
             }
         }
 
-        SceneNode *node = new SceneNode;
-        m_nodes.push_back(node);
-        parent->children.push_back(node);
+        int node = m_nodes.size();
+        m_nodes.emplace_back();
+        children.data[children.size++] = node;
+        m_nodes[parent].children = children;
 
         if (!parseGroupData(group.toObject(), node)) {
             return false;
@@ -804,7 +809,7 @@ bool ScenefileReader::parseGroups(const QJsonValue &groups, SceneNode *parent) {
 /**
  * Parse an <object type="primitive"> tag into node.
  */
-bool ScenefileReader::parsePrimitive(const QJsonObject &prim, SceneNode *node) {
+bool ScenefileReader::parsePrimitive(const QJsonObject &prim, ScenePrimitive *primitive) {
     QStringList requiredFields = {"type"};
     QStringList optionalFields = {
         "meshFile", "ambient", "diffuse", "specular", "reflective", "transparent", "shininess", "ior",
@@ -831,14 +836,12 @@ bool ScenefileReader::parsePrimitive(const QJsonObject &prim, SceneNode *node) {
     std::string primType = prim["type"].toString().toStdString();
 
     // Default primitive
-    ScenePrimitive *primitive = new ScenePrimitive();
     SceneMaterial &mat = primitive->material;
     mat.clear();
     primitive->type = PrimitiveType::PRIMITIVE_CUBE;
     mat.textureMap.isUsed = false;
     mat.bumpMap.isUsed = false;
     mat.cDiffuse.r = mat.cDiffuse.g = mat.cDiffuse.b = 1;
-    node->primitives.push_back(primitive);
 
     std::filesystem::path basepath = std::filesystem::path(file_name).parent_path().parent_path();
     if (primType == "sphere")
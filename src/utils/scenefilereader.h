@@ -1,6 +1,7 @@
 #pragma once
 
 #include "scenedata.h"
+#include "scenearena.h"
 
 #include <vector>
 #include <map>
@@ -24,7 +25,14 @@ public:
 
     SceneCameraData getCameraData() const;
 
-    SceneNode *getRootNode() const;
+    // The root is always the first node
+    const SceneNode &getRootNode() const;
+
+    // Every node of the graph, children refer to each other by index into this
+    const std::vector<SceneNode> &getNodes() const;
+
+    // Root node of every template group. References to a template point at its root.
+    std::vector<int> getTemplateNodes() const;
 
 private:
     // The filename should be contained within this parser implementation.
@@ -33,18 +41,20 @@ private:
     bool parseCameraData(const QJsonObject &cameradata);
     bool parseTemplateGroups(const QJsonValue &templateGroups);
     bool parseTemplateGroupData(const QJsonObject &templateGroup);
-    bool parseGroups(const QJsonValue &groups, SceneNode *parent);
-    bool parseGroupData(const QJsonObject &object, SceneNode *node);
-    bool parsePrimitive(const QJsonObject &prim, SceneNode *node);
-    bool parseLightData(const QJsonObject &lightData, SceneNode *node);
+    bool parseGroups(const QJsonValue &groups, int parent);
+    bool parseGroupData(const QJsonObject &object, int node);
+    bool parsePrimitive(const QJsonObject &prim, ScenePrimitive *primitive);
+    bool parseLightData(const QJsonObject &lightData, SceneLight *light);
 
     std::string file_name;
 
-    mutable std::map<std::string, SceneNode *> m_templates;
+    // Template name -> node index
+    mutable std::map<std::string, int> m_templates;
 
     SceneGlobalData m_globalData;
     SceneCameraData m_cameraData;
 
-    SceneNode *m_root;
-    std::vector<SceneNode *> m_nodes;
+    // Owns every transformation, primitive, light and child list; freed all at once
+    SceneArena m_arena;
+    std::vector<SceneNode> m_nodes;
 };
@@ -1,5 +1,6 @@
 #include "sceneparser.h"
 #include "scenefilereader.h"
+#include "scenecache.h"
 #include "shape/objloader.h"
 #include "shape/sphere.h"
 #include "shape/cube.h"
@@ -11,71 +12,126 @@
 #include <chrono>
 #include <iostream>
 
-void SceneParser::dfsData(glm::mat4 total_ctm, SceneNode &curr_node, RenderData &renderData) {
-    // Combine new transformations into the ctm
-    std::vector<SceneTransformation*> transforms = curr_node.transformations;
-    for (int j = 0; j < transforms.size(); j++) {
-        SceneTransformation transform = *transforms[j];
-        glm::mat4 new_mat;
-
+glm::mat4 SceneParser::composeTransforms(const SceneSpan<SceneTransformation> &transforms) {
+    glm::mat4 total_mat(1.0f);
+    for (const SceneTransformation &transform : transforms) {
         // Check for type of transform
         if (transform.type == TransformationType::TRANSFORMATION_TRANSLATE) {
-            new_mat = glm::translate(glm::mat4(1.0f), transform.translate);
+            total_mat = glm::translate(total_mat, transform.translate);
         } else if (transform.type == TransformationType::TRANSFORMATION_SCALE) {
-            new_mat = glm::scale(glm::mat4(1.0f), transform.scale);
+            total_mat = glm::scale(total_mat, transform.scale);
         } else if (transform.type == TransformationType::TRANSFORMATION_ROTATE) {
-            new_mat = glm::rotate(glm::mat4(1.0f), transform.angle, transform.rotate);
+            total_mat = glm::rotate(total_mat, transform.angle, transform.rotate);
         } else {
-            new_mat = transform.matrix;
+            total_mat = total_mat * transform.matrix;
         }
-
-        total_ctm = total_ctm * new_mat;
     }
+    return total_mat;
+}
 
-    // Add primitives and lights to be used for rendering
-    std::vector<ScenePrimitive*> curr_prims = curr_node.primitives;
-    for (int i = 0; i < curr_prims.size(); i++) {
-        RenderShapeData new_prim = {*curr_prims[i], total_ctm};
-        if (new_prim.primitive.type == PrimitiveType::PRIMITIVE_SPHERE) {
-            new_prim.shape = new Sphere();
-        }
-        else if (new_prim.primitive.type == PrimitiveType::PRIMITIVE_CYLINDER) {
-            new_prim.shape = new Cylinder();
-        }
-        else if (new_prim.primitive.type == PrimitiveType::PRIMITIVE_CONE) {
-            new_prim.shape = new Cone();
-        }
-        else if (new_prim.primitive.type == PrimitiveType::PRIMITIVE_CUBE) {
-            new_prim.shape = new Cube();
-        }
-        else if (new_prim.primitive.type == PrimitiveType::PRIMITIVE_MESH) {
-            new_prim.shape = new ObjLoader(new_prim.primitive.meshfile);
-        }
+SceneLightData SceneParser::transformLight(const glm::mat4 &ctm, const SceneLightData &light) {
+    SceneLightData transformed = light;
+    transformed.pos = ctm * light.pos;
+    transformed.dir = glm::normalize(ctm * light.dir);
+    return transformed;
+}
 
-        renderData.shapes.push_back(new_prim);
+void SceneParser::dfsData(glm::mat4 total_ctm, int root, const std::vector<SceneNode> &nodes, const std::vector<int> &node_templates,
+                          std::vector<RenderShapeData> &shapes, std::vector<SceneLightData> &lights, std::vector<TemplateReference> &references) {
+    auto isReference = [&](int child) { return node_templates[child] >= 0; };
+
+    // Counting pass so the output is allocated once. Templates are the only nodes with more
+    // than one parent and they aren't descended into, so every node is counted once.
+    int num_shapes = 0, num_lights = 0;
+    std::vector<int> count_stack = {root};
+    while (!count_stack.empty()) {
+        const SceneNode &node = nodes[count_stack.back()];
+        count_stack.pop_back();
+        num_shapes += node.primitives.size;
+        num_lights += node.lights.size;
+        for (int child : node.children) {
+            if (!isReference(child)) count_stack.push_back(child);
+        }
     }
+    shapes.reserve(shapes.size() + num_shapes);
+    lights.reserve(lights.size() + num_lights);
 
-    std::vector<SceneLight*> curr_lights = curr_node.lights;
-    for (int l = 0; l < curr_lights.size(); l++) {
-        SceneLight light = *curr_lights[l];
+    // Explicit stack instead of recursion; children are pushed in reverse so the output
+    // keeps the same order as a recursive depth-first walk
+    struct Visit {
+        int node;
+        glm::mat4 parent_ctm;
+    };
+    std::vector<Visit> stack = {{root, total_ctm}};
+    while (!stack.empty()) {
+        Visit visit = stack.back();
+        stack.pop_back();
 
-        // Needs to be in world space
-        glm::vec4 pos = total_ctm * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        glm::vec4 dir = glm::normalize(total_ctm * glm::vec4(light.dir.x, light.dir.y, light.dir.z, 0.0f));
+        const SceneNode &curr_node = nodes[visit.node];
+        glm::mat4 ctm = visit.parent_ctm * composeTransforms(curr_node.transformations);
+
+        // Add primitives and lights to be used for rendering
+        for (const ScenePrimitive &primitive : curr_node.primitives) {
+            RenderShapeData &new_prim = shapes.emplace_back();
+            new_prim.primitive = primitive;
+            new_prim.ctm = ctm;
+            new_prim.shape = makeShape(primitive);
+        }
 
-        SceneLightData new_light = {light.id, light.type, light.color, light.function, pos, dir,
+        for (const SceneLight &light : curr_node.lights) {
+            SceneLightData local = {light.id, light.type, light.color, light.function,
+                                    glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(light.dir.x, light.dir.y, light.dir.z, 0.0f),
                                     light.penumbra, light.angle, light.width, light.height};
-        renderData.lights.push_back(new_light);
+            lights.push_back(transformLight(ctm, local));
+        }
+
+        // Must get the children's properties as well. A template's own transformations are
+        // part of its contents, so the reference only carries the parent's ctm.
+        for (int k = curr_node.children.size - 1; k >= 0; k--) {
+            int child = curr_node.children[k];
+            if (isReference(child)) {
+                references.push_back({node_templates[child], ctm});
+            } else {
+                stack.push_back({child, ctm});
+            }
+        }
     }
+}
 
-    // Must get the children's properties as well
-    std::vector<SceneNode*> children = curr_node.children;
-    for (int k = 0; k < children.size(); k++) {
-        dfsData(total_ctm, *children[k], renderData);
+Shape *SceneParser::makeShape(const ScenePrimitive &primitive) {
+    if (primitive.type == PrimitiveType::PRIMITIVE_SPHERE) {
+        return new Sphere();
     }
+    else if (primitive.type == PrimitiveType::PRIMITIVE_CYLINDER) {
+        return new Cylinder();
+    }
+    else if (primitive.type == PrimitiveType::PRIMITIVE_CONE) {
+        return new Cone();
+    }
+    else if (primitive.type == PrimitiveType::PRIMITIVE_CUBE) {
+        return new Cube();
+    }
+    return new ObjLoader(primitive.meshfile);
 }
 
 bool SceneParser::parse(std::string filepath, RenderData &renderData) {
+    // A compiled snapshot of an unchanged scene skips JSON parsing and flattening entirely
+    std::string cachePath = SceneCache::cachePath(filepath);
+    auto start = std::chrono::steady_clock::now();
+    if (SceneCache::read(cachePath, filepath, renderData)) {
+        for (RenderShapeData &object : renderData.shapes) {
+            object.shape = makeShape(object.primitive);
+        }
+        for (RenderTemplateData &templ : renderData.templates) {
+            for (RenderShapeData &object : templ.shapes) {
+                object.shape = makeShape(object.primitive);
+            }
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Loaded compiled scene " << cachePath << " in " << ms << " ms" << std::endl;
+        return true;
+    }
+
     ScenefileReader fileReader = ScenefileReader(filepath);
     bool success = fileReader.readJSON();
     if (!success) {
@@ -85,11 +141,49 @@ bool SceneParser::parse(std::string filepath, RenderData &renderData) {
     renderData.globalData = fileReader.getGlobalData();
     renderData.cameraData = fileReader.getCameraData();
 
-    SceneNode* root = fileReader.getRootNode();
     renderData.shapes.clear();
     glm::mat4 total_ctm = glm::mat4(1.0f);
 
-    dfsData(total_ctm, *root, renderData);
+    const std::vector<SceneNode> &nodes = fileReader.getNodes();
+    std::vector<int> template_nodes = fileReader.getTemplateNodes();
+    std::vector<int> node_templates(nodes.size(), -1);
+    for (int i = 0; i < template_nodes.size(); i++) {
+        node_templates[template_nodes[i]] = i;
+    }
+
+    // Each template is flattened once, relative to its own root
+    renderData.templates.clear();
+    renderData.templates.resize(template_nodes.size());
+    std::vector<std::vector<TemplateReference>> nested_references(template_nodes.size());
+    for (int i = 0; i < template_nodes.size(); i++) {
+        RenderTemplateData &templ = renderData.templates[i];
+        dfsData(total_ctm, template_nodes[i], nodes, node_templates, templ.shapes, templ.lights, nested_references[i]);
+    }
+
+    // The root is always the first node
+    std::vector<TemplateReference> references;
+    dfsData(total_ctm, 0, nodes, node_templates, renderData.shapes, renderData.lights, references);
+
+    // Every reference becomes one instance. References made inside a template body are
+    // expanded once per instance of that template. Lights aren't instanced, so each
+    // instance adds world-space copies of its template's lights.
+    std::vector<TemplateReference> stack(references.rbegin(), references.rend());
+    while (!stack.empty()) {
+        TemplateReference reference = stack.back();
+        stack.pop_back();
+
+        RenderTemplateData &templ = renderData.templates[reference.id];
+        templ.instances.push_back(reference.ctm);
+        for (const SceneLightData &light : templ.lights) {
+            renderData.lights.push_back(transformLight(reference.ctm, light));
+        }
+
+        const std::vector<TemplateReference> &nested = nested_references[reference.id];
+        for (int k = nested.size() - 1; k >= 0; k--) {
+            stack.push_back({nested[k].id, reference.ctm * nested[k].ctm});
+        }
+    }
 
+    SceneCache::write(cachePath, filepath, renderData);
     return true;
 }
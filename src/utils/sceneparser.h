@@ -11,10 +11,21 @@
 struct RenderShapeData {
     ScenePrimitive primitive;
     glm::mat4 ctm; // the cumulative transformation matrix
+    glm::mat3 normal_mat = glm::mat3(1.f); // Inverse transpose of ctm, filled in by Realtime::createShape
     Shape* shape = nullptr;
     // For meshes
-    GLuint vao, vbo = 0;
+    GLuint vao = 0, vbo = 0;
     int num_verts = 0;
+    int upload_id = -1; // Pending background upload, if any
+};
+
+// A template group kept as one shared sub-scene. Its shapes are stored once, relative to the
+// template's root, and drawn with a single instanced call per shape for every reference.
+struct RenderTemplateData {
+    std::vector<RenderShapeData> shapes;
+    std::vector<SceneLightData> lights;  // Relative as well; world copies per instance are in RenderData::lights
+    std::vector<glm::mat4> instances;    // World transform of every reference to the template
+    GLuint instance_vbo = 0;
 };
 
 // Struct which contains all the data needed to render a scene
@@ -24,6 +35,13 @@ struct RenderData {
 
     std::vector<SceneLightData> lights;
     std::vector<RenderShapeData> shapes;
+    std::vector<RenderTemplateData> templates;
+};
+
+// A reference to a template found while flattening, resolved into instances afterwards
+struct TemplateReference {
+    int id;
+    glm::mat4 ctm;
 };
 
 class SceneParser {
@@ -33,5 +51,14 @@ public:
     // @param renderData  On return, this will contain the metadata of the loaded scene.
     // @return            A boolean value indicating whether the parse was successful.
     static bool parse(std::string filepath, RenderData &renderData);
-    static void dfsData(glm::mat4 total_ctm, SceneNode &curr_node, RenderData &renderData);
+    // Flattens the graph below root into shapes/lights. Children that are template roots
+    // (node_templates[child] >= 0) aren't descended into, they are added to references.
+    static void dfsData(glm::mat4 total_ctm, int root, const std::vector<SceneNode> &nodes, const std::vector<int> &node_templates,
+                        std::vector<RenderShapeData> &shapes, std::vector<SceneLightData> &lights, std::vector<TemplateReference> &references);
+    // Moves a light into the space ctm maps to
+    static SceneLightData transformLight(const glm::mat4 &ctm, const SceneLightData &light);
+    // Multiplies a node's transformations together, in order
+    static glm::mat4 composeTransforms(const SceneSpan<SceneTransformation> &transforms);
+    // Creates the CPU-side shape matching a primitive's type
+    static Shape *makeShape(const ScenePrimitive &primitive);
 };
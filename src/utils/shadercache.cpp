@@ -0,0 +1,126 @@
+#include "shadercache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[4] = {'F', 'L', 'P', 'B'};
+const uint32_t VERSION = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;     // Driver specific binary format
+    uint32_t length;
+};
+
+QString cachePath(const std::string &key) {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programs/"
+           + QString::fromStdString(key) + ".bin";
+}
+
+std::string glString(GLenum name) {
+    const GLubyte *value = glGetString(name);
+    return value ? reinterpret_cast<const char *>(value) : "";
+}
+
+}
+
+bool ShaderCache::supported() {
+    // Asked once, the answer can't change while the context lives
+    static int supported = -1;
+    if (supported < 0) {
+        GLint formats = 0;
+        if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0;
+    }
+    return supported;
+}
+
+std::string ShaderCache::key(const std::vector<std::string> &sources) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    // A binary is only valid for the driver that produced it
+    std::string driver = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION) + "\n";
+    hash.addData(QByteArray(driver.data(), driver.size()));
+    for (const std::string &source : sources) {
+        // Separated so moving code between stages changes the key
+        hash.addData(QByteArray(source.data(), source.size()));
+        hash.addData(QByteArray("\0", 1));
+    }
+    return hash.result().toHex().toStdString();
+}
+
+GLuint ShaderCache::load(const std::string &key) {
+    if (!supported()) {
+        return 0;
+    }
+
+    QFile file(cachePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QByteArray bytes = file.readAll();
+    if (bytes.size() < qsizetype(sizeof(Header))) {
+        return 0;
+    }
+    Header header;
+    memcpy(&header, bytes.constData(), sizeof(Header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || uint64_t(bytes.size()) != sizeof(Header) + header.length) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, bytes.constData() + sizeof(Header), header.length);
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        // Usually a driver update the version string didn't reveal, the caller rebuilds and overwrites it
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ShaderCache::store(GLuint program, const std::string &key) {
+    if (!supported()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.format = format;
+    header.length = length;
+
+    QString path = cachePath(key);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "[ShaderCache] Could not write " << path.toStdString() << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(binary.data(), length);
+    file.commit();
+}
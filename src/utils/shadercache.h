@@ -0,0 +1,29 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+// Linked program binaries kept in the user's cache directory, so later launches skip compiling
+// and linking. Entries are keyed by a hash of the shader sources and of the driver's identification,
+// so an edited shader or a driver update just misses. A driver may still refuse a binary, in
+// which case the program is built from source again.
+class ShaderCache {
+public:
+    // False if the driver has no binary formats (e.g. macOS), everything is compiled then
+    static bool supported();
+
+    // Hash of every stage's source plus the driver strings
+    static std::string key(const std::vector<std::string> &sources);
+
+    // A linked program from the binary stored under key, or 0 if there is none or it was rejected
+    static GLuint load(const std::string &key);
+
+    // Stores the binary of a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    static void store(GLuint program, const std::string &key);
+};
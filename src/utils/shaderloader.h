@@ -5,59 +5,105 @@
 #define GL_SILENCE_DEPRECATION
 #endif
 #include <GL/glew.h>
+#include "shadercache.h"
+
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
 #include <iostream>
 
 class ShaderLoader{
 public:
     static GLuint createShaderProgram(const char * vertex_file_path, const char * fragment_file_path){
+        return createShaderProgramFromSource(readFile(vertex_file_path), readFile(fragment_file_path));
+    }
+
+    // Same as createShaderProgram, for generated code
+    static GLuint createShaderProgramFromSource(const std::string &vertexCode, const std::string &fragmentCode){
+        // A binary linked by an earlier run skips both compiles and the link
+        std::string key = ShaderCache::key({vertexCode, fragmentCode});
+        if (GLuint cached = ShaderCache::load(key)) {
+            return cached;
+        }
+
         // Create and compile the shaders.
-        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
-        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
+        GLuint vertexShaderID = compileShader(GL_VERTEX_SHADER, vertexCode);
+        GLuint fragmentShaderID;
+        try {
+            fragmentShaderID = compileShader(GL_FRAGMENT_SHADER, fragmentCode);
+        } catch (...) {
+            glDeleteShader(vertexShaderID);
+            throw;
+        }
 
         // Link the shader program.
         GLuint programID = glCreateProgram();
         glAttachShader(programID, vertexShaderID);
         glAttachShader(programID, fragmentShaderID);
-        glLinkProgram(programID);
 
-        // Print the info log if error
-        GLint status;
-        glGetProgramiv(programID, GL_LINK_STATUS, &status);
-
-        if (status == GL_FALSE) {
-            GLint length;
-            glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
+        // Shaders no longer necessary once linked, stored in program
+        glDeleteShader(vertexShaderID);
+        glDeleteShader(fragmentShaderID);
 
-            std::string log(length, '\0');
-            glGetProgramInfoLog(programID, length, nullptr, &log[0]);
+        return linkProgram(programID, key);
+    }
 
-            glDeleteProgram(programID);
-            throw std::runtime_error(log);
+    // Needs a GL 4.3 context
+    static GLuint createComputeProgram(const char * compute_file_path){
+        std::string code = readFile(compute_file_path);
+        std::string key = ShaderCache::key({code});
+        if (GLuint cached = ShaderCache::load(key)) {
+            return cached;
         }
 
-        // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
+        GLuint computeShaderID = compileShader(GL_COMPUTE_SHADER, code);
 
-        return programID;
+        GLuint programID = glCreateProgram();
+        glAttachShader(programID, computeShaderID);
+        glDeleteShader(computeShaderID);
+
+        return linkProgram(programID, key);
     }
 
-private:
-    static GLuint createShader(GLenum shaderType, const char *filepath){
-        GLuint shaderID = glCreateShader(shaderType);
+    // Dev mode (see ShaderReloader): files under :/resources/shaders are read from dir instead.
+    // An empty dir goes back to the resources.
+    static void setSourceDir(const QString &dir){
+        sourceDir() = dir;
+    }
+
+    // Reads a shader file. Lines of the form #include "file" are replaced by that file,
+    // looked up next to the including one.
+    static std::string readFile(const QString &filepath){
+        QString prefix = ":/resources/shaders/";
+        QFile file(!sourceDir().isEmpty() && filepath.startsWith(prefix)
+                       ? sourceDir() + "/" + filepath.mid(prefix.size()) : filepath);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            throw std::runtime_error("Failed to open shader: " + filepath.toStdString());
+        }
 
-        // Read shader file.
         std::string code;
-        QString filepathStr = QString(filepath);
-        QFile file(filepathStr);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream stream(&file);
-            code = stream.readAll().toStdString();
-        }else{
-            throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
+        QTextStream stream(&file);
+        while (!stream.atEnd()) {
+            QString line = stream.readLine();
+            QString trimmed = line.trimmed();
+            if (trimmed.startsWith("#include")) {
+                QString name = trimmed.section('"', 1, 1);
+                code += readFile(QFileInfo(filepath).path() + "/" + name);
+            } else {
+                code += line.toStdString() + "\n";
+            }
         }
+        return code;
+    }
+
+private:
+    static QString &sourceDir(){
+        static QString dir;
+        return dir;
+    }
+
+    static GLuint compileShader(GLenum shaderType, const std::string &code){
+        GLuint shaderID = glCreateShader(shaderType);
 
         // Compile shader code.
         const char *codePtr = code.c_str();
@@ -81,4 +127,30 @@ private:
 
         return shaderID;
     }
+
+    // Stores the linked binary under key in the ShaderCache
+    static GLuint linkProgram(GLuint programID, const std::string &key){
+        if (ShaderCache::supported()) {
+            glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(programID);
+
+        // Print the info log if error
+        GLint status;
+        glGetProgramiv(programID, GL_LINK_STATUS, &status);
+
+        if (status == GL_FALSE) {
+            GLint length;
+            glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
+
+            std::string log(length, '\0');
+            glGetProgramInfoLog(programID, length, nullptr, &log[0]);
+
+            glDeleteProgram(programID);
+            throw std::runtime_error(log);
+        }
+
+        ShaderCache::store(programID, key);
+        return programID;
+    }
 };
@@ -0,0 +1,216 @@
+#include "shaderreloader.h"
+#include "shadercache.h"
+#include "shaderloader.h"
+
+#include <QDir>
+
+#include <iostream>
+
+namespace {
+
+std::string describe(const std::vector<std::pair<GLenum, QString>> &stages) {
+    std::string names;
+    for (const auto &[type, path] : stages) {
+        if (!names.empty()) names += " + ";
+        names += QFileInfo(path).fileName().toStdString();
+    }
+    return names;
+}
+
+std::string shaderLog(GLuint shader) {
+    GLint status, length;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_TRUE) return "";
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    std::string log(std::max(length, 1), '\0');
+    glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+    return log;
+}
+
+}
+
+void ShaderReloader::start(const QString &dir) {
+    if (!QDir(dir).exists()) {
+        std::cerr << "[ShaderReload] No shader directory " << dir.toStdString() << ", using the built-in shaders" << std::endl;
+        return;
+    }
+    m_dir = dir;
+    ShaderLoader::setSourceDir(dir);
+
+    // Lets the driver compile on its own threads, so polling never waits on a compile
+    m_parallel = GLEW_KHR_parallel_shader_compile;
+    if (m_parallel) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+
+    m_watcher = std::make_unique<QFileSystemWatcher>();
+    QObject::connect(m_watcher.get(), &QFileSystemWatcher::fileChanged, [this](const QString &) { m_changed = true; });
+    QObject::connect(m_watcher.get(), &QFileSystemWatcher::directoryChanged, [this](const QString &) { m_changed = true; });
+    watchFiles();
+    std::cout << "[ShaderReload] Watching " << dir.toStdString()
+              << (m_parallel ? " (parallel compile)" : "") << std::endl;
+}
+
+void ShaderReloader::stop() {
+    for (Entry &entry : m_entries) {
+        discard(entry);
+    }
+    m_entries.clear();
+    m_watcher.reset();
+}
+
+void ShaderReloader::create(GLuint *program, const char *vertexPath, const char *fragmentPath) {
+    try {
+        *program = ShaderLoader::createShaderProgram(vertexPath, fragmentPath);
+    } catch (const std::runtime_error &e) {
+        if (!active()) throw;
+        // The built-in version is the last one known to work
+        std::cerr << "[ShaderReload] " << vertexPath << " + " << fragmentPath << ": " << e.what() << std::endl
+                  << "[ShaderReload] Using the built-in version until it is fixed" << std::endl;
+        ShaderLoader::setSourceDir(QString());
+        *program = ShaderLoader::createShaderProgram(vertexPath, fragmentPath);
+        ShaderLoader::setSourceDir(m_dir);
+    }
+    add(program, {{GL_VERTEX_SHADER, vertexPath}, {GL_FRAGMENT_SHADER, fragmentPath}});
+}
+
+void ShaderReloader::createCompute(GLuint *program, const char *computePath) {
+    *program = ShaderLoader::createComputeProgram(computePath);
+    add(program, {{GL_COMPUTE_SHADER, computePath}});
+}
+
+void ShaderReloader::add(GLuint *program, std::vector<std::pair<GLenum, QString>> stages) {
+    if (!active()) return;
+
+    Entry entry;
+    entry.program = program;
+    entry.stages = std::move(stages);
+    try {
+        for (const auto &[type, path] : entry.stages) {
+            entry.sources.push_back(ShaderLoader::readFile(path));
+        }
+    } catch (const std::runtime_error &) {
+        // Missing on disk, rebuilt once the file appears
+        entry.sources.clear();
+    }
+    m_entries.push_back(std::move(entry));
+}
+
+void ShaderReloader::watchFiles() {
+    // Editors often save by replacing the file, which drops it from the watcher
+    QStringList paths;
+    QStringList dirs = {m_dir};
+    for (int i = 0; i < dirs.size(); i++) {
+        QDir dir(dirs[i]);
+        paths.push_back(dirs[i]);
+        for (const QString &name : dir.entryList(QDir::Files)) {
+            paths.push_back(dir.filePath(name));
+        }
+        for (const QString &name : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            dirs.push_back(dir.filePath(name));
+        }
+    }
+    m_watcher->addPaths(paths);
+}
+
+bool ShaderReloader::poll() {
+    if (!active()) return false;
+
+    if (m_changed) {
+        m_changed = false;
+        watchFiles();
+        for (Entry &entry : m_entries) {
+            begin(entry);
+        }
+        if (onSourcesChanged) onSourcesChanged();
+    }
+
+    bool swapped = false;
+    for (Entry &entry : m_entries) {
+        if (entry.pending && finish(entry)) swapped = true;
+    }
+    return swapped;
+}
+
+void ShaderReloader::begin(Entry &entry) {
+    std::vector<std::string> sources;
+    try {
+        for (const auto &[type, path] : entry.stages) {
+            sources.push_back(ShaderLoader::readFile(path));
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << "[ShaderReload] " << e.what() << std::endl;
+        return;
+    }
+    if (sources == entry.sources) return;
+    entry.sources = sources;
+
+    // A newer edit supersedes a rebuild that is still compiling
+    discard(entry);
+
+    // Status is only queried in finish(), querying here would wait for the compile
+    entry.pending = glCreateProgram();
+    for (int i = 0; i < entry.stages.size(); i++) {
+        GLuint shader = glCreateShader(entry.stages[i].first);
+        const char *code = sources[i].c_str();
+        glShaderSource(shader, 1, &code, nullptr);
+        glCompileShader(shader);
+        glAttachShader(entry.pending, shader);
+        entry.shaders.push_back(shader);
+    }
+    if (ShaderCache::supported()) {
+        glProgramParameteri(entry.pending, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(entry.pending);
+}
+
+bool ShaderReloader::finish(Entry &entry) {
+    if (m_parallel) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(entry.pending, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done) return false;
+    }
+
+    GLint status;
+    glGetProgramiv(entry.pending, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        std::string log;
+        for (GLuint shader : entry.shaders) {
+            log += shaderLog(shader);
+        }
+        if (log.empty()) {
+            GLint length;
+            glGetProgramiv(entry.pending, GL_INFO_LOG_LENGTH, &length);
+            log.assign(std::max(length, 1), '\0');
+            glGetProgramInfoLog(entry.pending, length, nullptr, &log[0]);
+        }
+        std::cerr << "[ShaderReload] " << describe(entry.stages) << " failed, keeping the previous version:\n"
+                  << log << std::endl;
+        discard(entry);
+        return false;
+    }
+
+    ShaderCache::store(entry.pending, ShaderCache::key(entry.sources));
+    for (GLuint shader : entry.shaders) {
+        glDetachShader(entry.pending, shader);
+        glDeleteShader(shader);
+    }
+    entry.shaders.clear();
+
+    glDeleteProgram(*entry.program);
+    *entry.program = entry.pending;
+    entry.pending = 0;
+    std::cout << "[ShaderReload] Reloaded " << describe(entry.stages) << std::endl;
+    return true;
+}
+
+void ShaderReloader::discard(Entry &entry) {
+    for (GLuint shader : entry.shaders) {
+        glDeleteShader(shader);
+    }
+    entry.shaders.clear();
+    if (entry.pending) {
+        glDeleteProgram(entry.pending);
+        entry.pending = 0;
+    }
+}
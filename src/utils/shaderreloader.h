@@ -0,0 +1,66 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <QFileSystemWatcher>
+#include <QString>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Dev mode: shaders are read from a directory on disk instead of the Qt resources and rebuilt
+// whenever a file there changes. Rebuilds are compiled in the background where the driver
+// supports GL_KHR_parallel_shader_compile, and only replace a program once they have linked, so
+// a typo leaves the last good version running. Without a directory nothing is watched and
+// programs are built once as before.
+class ShaderReloader {
+public:
+    // Called on the GUI thread with the context current. dir mirrors resources/shaders.
+    void start(const QString &dir);
+    // Deletes unfinished rebuilds; the programs themselves belong to the caller
+    void stop();
+
+    bool active() const { return !m_dir.isEmpty(); }
+
+    // Builds *program and rebuilds it in place when its sources change. A program whose disk
+    // version doesn't compile at startup falls back to the built-in one.
+    void create(GLuint *program, const char *vertexPath, const char *fragmentPath);
+    // Needs a GL 4.3 context, throws like ShaderLoader::createComputeProgram
+    void createCompute(GLuint *program, const char *computePath);
+
+    // Starts rebuilding programs whose sources changed and swaps in those that finished.
+    // Returns true if any program was replaced, so its uniforms need to be looked up again.
+    bool poll();
+
+    // Called when any shader file changed, for programs built outside of the reloader
+    std::function<void()> onSourcesChanged;
+
+private:
+    struct Entry {
+        GLuint *program;
+        std::vector<std::pair<GLenum, QString>> stages;
+        // Sources of the last build attempt, a rebuild only starts once they differ
+        std::vector<std::string> sources;
+        GLuint pending = 0;
+        std::vector<GLuint> shaders;
+    };
+
+    void add(GLuint *program, std::vector<std::pair<GLenum, QString>> stages);
+    void watchFiles();
+    void begin(Entry &entry);
+    // Returns true if the pending program linked and replaced the old one
+    bool finish(Entry &entry);
+    static void discard(Entry &entry);
+
+    QString m_dir;
+    std::unique_ptr<QFileSystemWatcher> m_watcher;
+    bool m_changed = false;
+    bool m_parallel = false;
+    std::vector<Entry> m_entries;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+// Uniform locations of each program, resolved once after it is built so drawing never looks
+// a uniform up by name. Fields are named after the GLSL uniforms; -1 means the driver
+// optimized the uniform out, which glUniform* ignores.
+
+struct LightingUniforms {
+    GLint view_mat, view_proj, model_mat, normal_mat, mvp_mat, instanced;
+    GLint camera_pos, curr_view_proj, prev_view_proj;
+    GLint ka, kd, ks;
+    GLint ambient, diffuse, specular, shininess;
+    GLint texture_layer, texture_repeat, texture_blend;
+    GLint env_ambient, env_lod;
+    GLint screen_size, min_dist, max_dist;
+
+    void resolve(GLuint program) {
+        view_mat = glGetUniformLocation(program, "view_mat");
+        view_proj = glGetUniformLocation(program, "view_proj");
+        model_mat = glGetUniformLocation(program, "model_mat");
+        normal_mat = glGetUniformLocation(program, "normal_mat");
+        mvp_mat = glGetUniformLocation(program, "mvp_mat");
+        instanced = glGetUniformLocation(program, "instanced");
+        camera_pos = glGetUniformLocation(program, "camera_pos");
+        curr_view_proj = glGetUniformLocation(program, "curr_view_proj");
+        prev_view_proj = glGetUniformLocation(program, "prev_view_proj");
+        ka = glGetUniformLocation(program, "ka");
+        kd = glGetUniformLocation(program, "kd");
+        ks = glGetUniformLocation(program, "ks");
+        ambient = glGetUniformLocation(program, "ambient");
+        diffuse = glGetUniformLocation(program, "diffuse");
+        specular = glGetUniformLocation(program, "specular");
+        shininess = glGetUniformLocation(program, "shininess");
+        texture_layer = glGetUniformLocation(program, "texture_layer");
+        texture_repeat = glGetUniformLocation(program, "texture_repeat");
+        texture_blend = glGetUniformLocation(program, "texture_blend");
+        env_ambient = glGetUniformLocation(program, "env_ambient");
+        env_lod = glGetUniformLocation(program, "env_lod");
+        screen_size = glGetUniformLocation(program, "screen_size");
+        min_dist = glGetUniformLocation(program, "min_dist");
+        max_dist = glGetUniformLocation(program, "max_dist");
+    }
+};
+
+struct DepthUniforms {
+    GLint view_proj, model_mat, mvp_mat, instanced;
+
+    void resolve(GLuint program) {
+        view_proj = glGetUniformLocation(program, "view_proj");
+        model_mat = glGetUniformLocation(program, "model_mat");
+        mvp_mat = glGetUniformLocation(program, "mvp_mat");
+        instanced = glGetUniformLocation(program, "instanced");
+    }
+};
+
+struct SkyUniforms {
+    GLint inv_view_proj, curr_view_proj, prev_view_proj;
+
+    void resolve(GLuint program) {
+        inv_view_proj = glGetUniformLocation(program, "inv_view_proj");
+        curr_view_proj = glGetUniformLocation(program, "curr_view_proj");
+        prev_view_proj = glGetUniformLocation(program, "prev_view_proj");
+    }
+};
+
+struct FireUniforms {
+    GLint view_proj, camera_right, camera_up, camera_back, radius;
+    GLint depth_scale, depth_params, soft_distance;
+
+    void resolve(GLuint program) {
+        view_proj = glGetUniformLocation(program, "view_proj");
+        camera_right = glGetUniformLocation(program, "camera_right");
+        camera_up = glGetUniformLocation(program, "camera_up");
+        camera_back = glGetUniformLocation(program, "camera_back");
+        radius = glGetUniformLocation(program, "radius");
+        depth_scale = glGetUniformLocation(program, "depth_scale");
+        depth_params = glGetUniformLocation(program, "depth_params");
+        soft_distance = glGetUniformLocation(program, "soft_distance");
+    }
+};
+
+struct ParticleCompositeUniforms {
+    GLint depth_scale, depth_params;
+
+    void resolve(GLuint program) {
+        depth_scale = glGetUniformLocation(program, "depth_scale");
+        depth_params = glGetUniformLocation(program, "depth_params");
+    }
+};
+
+struct BloomDownUniforms {
+    GLint karis, threshold;
+
+    void resolve(GLuint program) {
+        karis = glGetUniformLocation(program, "karis");
+        threshold = glGetUniformLocation(program, "threshold");
+    }
+};
+
+struct BloomUpUniforms {
+    GLint radius;
+
+    void resolve(GLuint program) {
+        radius = glGetUniformLocation(program, "radius");
+    }
+};
+
+struct TAAUniforms {
+    GLint historyValid, feedback;
+
+    void resolve(GLuint program) {
+        historyValid = glGetUniformLocation(program, "historyValid");
+        feedback = glGetUniformLocation(program, "feedback");
+    }
+};
+
+struct KuwaharaBlurUniforms {
+    GLint u_direction;
+
+    void resolve(GLuint program) {
+        u_direction = glGetUniformLocation(program, "u_direction");
+    }
+};
+
+// Shared by the prep pass and both filter programs, the prep pass has no u_radius
+struct KuwaharaUniforms {
+    GLint u_texelSize, u_radius;
+
+    void resolve(GLuint program) {
+        u_texelSize = glGetUniformLocation(program, "u_texelSize");
+        u_radius = glGetUniformLocation(program, "u_radius");
+    }
+};
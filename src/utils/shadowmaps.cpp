@@ -0,0 +1,217 @@
+#include "shadowmaps.h"
+#include "lightclusters.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Cascades cover at most this far from the camera
+const float SHADOW_DISTANCE = 40.f;
+// How far behind a cascade's box casters are still caught
+const float CASTER_DISTANCE = 30.f;
+// Blend between logarithmic (1) and uniform (0) cascade splits
+const float SPLIT_LAMBDA = 0.7f;
+
+glm::vec3 upFor(const glm::vec3 &dir) {
+    return std::abs(dir.y) > 0.99f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+}
+
+}
+
+GLuint ShadowMaps::makeArray(int size, int layers, std::vector<Layer> &fbos) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    // Hardware comparison, with linear filtering every tap is already a 2x2 PCF
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    // Outside the map counts as lit
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    float border[4] = {1.f, 1.f, 1.f, 1.f};
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+    fbos.resize(layers);
+    for (int i = 0; i < layers; i++) {
+        glGenFramebuffers(1, &fbos[i].fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[i].fbo);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, i);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+void ShadowMaps::init() {
+    m_cascade_texture = makeArray(CASCADE_SIZE, CASCADES, m_cascades);
+    m_spot_texture = makeArray(SPOT_SIZE, MAX_SPOT_SHADOWS, m_spots);
+}
+
+void ShadowMaps::destroy() {
+    for (std::vector<Layer> *layers : {&m_cascades, &m_spots}) {
+        for (Layer &layer : *layers) {
+            glDeleteFramebuffers(1, &layer.fbo);
+        }
+        layers->clear();
+    }
+    glDeleteTextures(1, &m_cascade_texture);
+    glDeleteTextures(1, &m_spot_texture);
+}
+
+void ShadowMaps::invalidate() {
+    for (Layer &layer : m_cascades) layer.valid = false;
+    for (Layer &layer : m_spots) layer.valid = false;
+}
+
+bool ShadowMaps::refresh(Layer &layer, const glm::vec4 key[3], int version) {
+    if (layer.valid && layer.version == version
+        && layer.key[0] == key[0] && layer.key[1] == key[1] && layer.key[2] == key[2]) {
+        return false;
+    }
+    layer.valid = true;
+    layer.version = version;
+    std::copy(key, key + 3, layer.key);
+    return true;
+}
+
+void ShadowMaps::render(Layer &layer, int size, const glm::mat4 &view, const glm::mat4 &proj, const DrawCasters &draw) {
+    glBindFramebuffer(GL_FRAMEBUFFER, layer.fbo);
+    glViewport(0, 0, size, size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    draw(view, proj);
+    layer.viewProj = proj * view;
+}
+
+bool ShadowMaps::update(const std::vector<SceneLightData> &lights, const glm::mat4 &view,
+                        float near, float far, float heightAngle, float aspect,
+                        int geometryVersion, const DrawCasters &draw) {
+    m_layers.assign(lights.size(), -1);
+    m_has_directional = false;
+    m_spot_count = 0;
+    bool drawn = false;
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    // Slope scaled bias against acne, the rest is done with a normal offset when sampling
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.f, 4.f);
+
+    for (int i = 0; i < lights.size(); i++) {
+        const SceneLightData &light = lights[i];
+
+        if (light.type == LightType::LIGHT_DIRECTIONAL && !m_has_directional) {
+            m_has_directional = true;
+            m_layers[i] = 0;
+
+            glm::vec3 dir = glm::normalize(glm::vec3(light.dir));
+            glm::mat4 light_view = glm::lookAt(glm::vec3(0.f), dir, upFor(dir));
+            glm::mat4 inv_view = glm::inverse(view);
+            float tan_y = std::tan(heightAngle / 2.f);
+            float tan_x = tan_y * aspect;
+            float shadow_far = std::min(far, SHADOW_DISTANCE);
+
+            float d0 = near;
+            for (int c = 0; c < CASCADES; c++) {
+                float t = float(c + 1) / CASCADES;
+                float d1 = SPLIT_LAMBDA * near * std::pow(shadow_far / near, t)
+                           + (1.f - SPLIT_LAMBDA) * (near + (shadow_far - near) * t);
+                m_splits[c] = d1;
+
+                // Bounding sphere of the frustum slice: its size doesn't change as the camera
+                // turns, so with the center snapped to whole texels the map stays put
+                glm::vec3 corners[8];
+                glm::vec3 center(0.f);
+                for (int k = 0; k < 8; k++) {
+                    float d = k < 4 ? d0 : d1;
+                    glm::vec4 corner((k & 1 ? 1.f : -1.f) * d * tan_x, (k & 2 ? 1.f : -1.f) * d * tan_y, -d, 1.f);
+                    corners[k] = glm::vec3(inv_view * corner);
+                    center += corners[k] / 8.f;
+                }
+                float radius = 0.f;
+                for (const glm::vec3 &corner : corners) {
+                    radius = std::max(radius, glm::length(corner - center));
+                }
+                radius = std::ceil(radius * 16.f) / 16.f;
+
+                glm::vec3 c_light = glm::vec3(light_view * glm::vec4(center, 1.f));
+                float texel = 2.f * radius / CASCADE_SIZE;
+                float depth_step = radius * 0.5f;
+                c_light.x = std::floor(c_light.x / texel) * texel;
+                c_light.y = std::floor(c_light.y / texel) * texel;
+                c_light.z = std::floor(c_light.z / depth_step) * depth_step;
+
+                glm::mat4 proj = glm::ortho(c_light.x - radius, c_light.x + radius,
+                                            c_light.y - radius, c_light.y + radius,
+                                            -c_light.z - radius - depth_step - CASTER_DISTANCE,
+                                            -c_light.z + radius + depth_step);
+
+                glm::vec4 key[3] = {glm::vec4(dir, 0.f), glm::vec4(c_light, radius), glm::vec4(0.f)};
+                if (refresh(m_cascades[c], key, geometryVersion)) {
+                    render(m_cascades[c], CASCADE_SIZE, light_view, proj, draw);
+                    drawn = true;
+                }
+                d0 = d1;
+            }
+        } else if (light.type == LightType::LIGHT_SPOT && m_spot_count < MAX_SPOT_SHADOWS) {
+            int layer = m_spot_count++;
+            m_layers[i] = layer;
+
+            glm::vec3 pos = glm::vec3(light.pos);
+            glm::vec3 dir = glm::normalize(glm::vec3(light.dir));
+            float range = std::min(LightClusters::lightRange(light, far), far);
+            float fov = std::min(2.f * light.angle + 0.1f, 3.f);
+
+            glm::vec4 key[3] = {glm::vec4(pos, light.angle), glm::vec4(dir, range), glm::vec4(0.f)};
+            if (refresh(m_spots[layer], key, geometryVersion)) {
+                glm::mat4 light_view = glm::lookAt(pos, pos + dir, upFor(dir));
+                glm::mat4 proj = glm::perspective(fov, 1.f, 0.05f, std::max(range, 0.1f));
+                render(m_spots[layer], SPOT_SIZE, light_view, proj, draw);
+                drawn = true;
+            }
+        }
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    return drawn;
+}
+
+void ShadowMaps::resolveUniforms(GLuint program) {
+    m_u_cascade_shadows = glGetUniformLocation(program, "cascade_shadows");
+    m_u_spot_shadows = glGetUniformLocation(program, "spot_shadows");
+    m_u_cascade_matrices = glGetUniformLocation(program, "cascade_matrices");
+    m_u_cascade_splits = glGetUniformLocation(program, "cascade_splits");
+    m_u_cascade_texels = glGetUniformLocation(program, "cascade_texels");
+    m_u_spot_matrices = glGetUniformLocation(program, "spot_matrices");
+}
+
+void ShadowMaps::bind(int firstUnit) const {
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_cascade_texture);
+    glUniform1i(m_u_cascade_shadows, firstUnit);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_spot_texture);
+    glUniform1i(m_u_spot_shadows, firstUnit + 1);
+    glActiveTexture(GL_TEXTURE0);
+
+    glm::mat4 cascades[CASCADES], spots[MAX_SPOT_SHADOWS];
+    float texels[CASCADES];
+    for (int i = 0; i < CASCADES; i++) {
+        cascades[i] = m_cascades[i].viewProj;
+        // World size of a texel, the cascade's radius is the w of its second key
+        texels[i] = m_cascades[i].valid ? 2.f * m_cascades[i].key[1].w / CASCADE_SIZE : 0.f;
+    }
+    for (int i = 0; i < MAX_SPOT_SHADOWS; i++) {
+        spots[i] = m_spots[i].viewProj;
+    }
+    glUniformMatrix4fv(m_u_cascade_matrices, CASCADES, GL_FALSE, &cascades[0][0][0]);
+    glUniform3f(m_u_cascade_splits, m_splits[0], m_splits[1], m_splits[2]);
+    glUniform3f(m_u_cascade_texels, texels[0], texels[1], texels[2]);
+    glUniformMatrix4fv(m_u_spot_matrices, MAX_SPOT_SHADOWS, GL_FALSE, &spots[0][0][0]);
+}
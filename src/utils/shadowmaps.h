@@ -0,0 +1,79 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "scenedata.h"
+
+// Cascaded shadow maps for the first directional light and single maps for up to
+// MAX_SPOT_SHADOWS spot lights, stored as layers of two depth texture arrays.
+// Every layer remembers what it was rendered for (light, snapped cascade box, geometry
+// version) and is only redrawn when that changes, so a still camera over a static scene
+// costs no shadow draws at all.
+class ShadowMaps
+{
+public:
+    static const int CASCADES = 3;
+    static const int CASCADE_SIZE = 1024;
+    static const int MAX_SPOT_SHADOWS = 4;
+    static const int SPOT_SIZE = 512;
+
+    // Draws every caster visible to proj * view into the currently bound depth target
+    using DrawCasters = std::function<void(const glm::mat4 &view, const glm::mat4 &proj)>;
+
+    // Called with the context current
+    void init();
+    void destroy();
+
+    // Brings the maps up to date for this frame's lights and camera. geometryVersion must
+    // change whenever any caster does. Returns whether anything was redrawn.
+    bool update(const std::vector<SceneLightData> &lights, const glm::mat4 &view,
+                float near, float far, float heightAngle, float aspect,
+                int geometryVersion, const DrawCasters &draw);
+
+    // Shadow layer of every light passed to update, -1 for lights without shadows.
+    // Directional lights use all cascades and report 0.
+    const std::vector<int> &layers() const { return m_layers; }
+
+    GLuint cascadeTexture() const { return m_cascade_texture; }
+
+    // Looks up the shadow uniforms of the program bind() will be used with
+    void resolveUniforms(GLuint program);
+    // Binds both arrays to units firstUnit and firstUnit + 1 and sets the shadow uniforms of the current program
+    void bind(int firstUnit) const;
+
+    // Drops every cached map, e.g. after the scene changed
+    void invalidate();
+
+private:
+    struct Layer {
+        GLuint fbo = 0;
+        glm::mat4 viewProj = glm::mat4(1.f);
+        // What the layer currently holds
+        bool valid = false;
+        int version = -1;
+        glm::vec4 key[3];
+    };
+
+    static GLuint makeArray(int size, int layers, std::vector<Layer> &fbos);
+    static bool refresh(Layer &layer, const glm::vec4 key[3], int version);
+    void render(Layer &layer, int size, const glm::mat4 &view, const glm::mat4 &proj, const DrawCasters &draw);
+
+    GLuint m_cascade_texture = 0, m_spot_texture = 0;
+    std::vector<Layer> m_cascades, m_spots;
+    glm::vec4 m_splits = glm::vec4(0.f); // Far view depth of each cascade
+    int m_spot_count = 0;
+    bool m_has_directional = false;
+    std::vector<int> m_layers;
+
+    // Locations in the program passed to resolveUniforms
+    GLint m_u_cascade_shadows = -1, m_u_spot_shadows = -1;
+    GLint m_u_cascade_matrices = -1, m_u_cascade_splits = -1, m_u_cascade_texels = -1, m_u_spot_matrices = -1;
+};
@@ -0,0 +1,126 @@
+#include "texturecodec.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+uint16_t to565(const glm::vec3 &c) {
+    int r = std::clamp(int(std::round(c.r / 255.f * 31.f)), 0, 31);
+    int g = std::clamp(int(std::round(c.g / 255.f * 63.f)), 0, 63);
+    int b = std::clamp(int(std::round(c.b / 255.f * 31.f)), 0, 31);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+glm::vec3 from565(uint16_t c) {
+    return glm::vec3(((c >> 11) & 31) * 255.f / 31.f, ((c >> 5) & 63) * 255.f / 63.f, (c & 31) * 255.f / 31.f);
+}
+
+// One 4x4 block: endpoints along the principal axis of the block's colors, then the
+// nearest of the four palette entries for every texel
+void encodeBlock(const glm::vec3 texels[16], uint8_t *out) {
+    glm::vec3 mean(0.f);
+    for (int i = 0; i < 16; i++) mean += texels[i] / 16.f;
+
+    glm::mat3 cov(0.f);
+    for (int i = 0; i < 16; i++) {
+        glm::vec3 d = texels[i] - mean;
+        cov += glm::outerProduct(d, d);
+    }
+    // A few power iterations are plenty for a 3x3 covariance
+    glm::vec3 axis(0.577f);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 next = cov * axis;
+        float length = glm::length(next);
+        if (length < 1e-6f) break;
+        axis = next / length;
+    }
+
+    float lo = 0.f, hi = 0.f;
+    for (int i = 0; i < 16; i++) {
+        float t = glm::dot(texels[i] - mean, axis);
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    uint16_t c0 = to565(mean + axis * hi);
+    uint16_t c1 = to565(mean + axis * lo);
+    // c0 > c1 selects the four color mode
+    if (c0 < c1) std::swap(c0, c1);
+
+    glm::vec3 palette[4] = {from565(c0), from565(c1)};
+    palette[2] = (2.f * palette[0] + palette[1]) / 3.f;
+    palette[3] = (palette[0] + 2.f * palette[1]) / 3.f;
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            float best_dist = std::numeric_limits<float>::max();
+            for (int p = 0; p < 4; p++) {
+                glm::vec3 d = texels[i] - palette[p];
+                float dist = glm::dot(d, d);
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = p;
+                }
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = (indices >> (8 * i)) & 0xff;
+    }
+}
+
+}
+
+std::vector<uint8_t> TextureCodec::halve(const std::vector<uint8_t> &rgba, int size) {
+    int half = std::max(size / 2, 1);
+    std::vector<uint8_t> dst(size_t(half) * half * 4);
+    for (int y = 0; y < half; y++) {
+        for (int x = 0; x < half; x++) {
+            // Clamped so a 1 pixel wide source still works
+            int x0 = std::min(2 * x, size - 1), x1 = std::min(2 * x + 1, size - 1);
+            int y0 = std::min(2 * y, size - 1), y1 = std::min(2 * y + 1, size - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = rgba[(size_t(y0) * size + x0) * 4 + c] + rgba[(size_t(y0) * size + x1) * 4 + c]
+                          + rgba[(size_t(y1) * size + x0) * 4 + c] + rgba[(size_t(y1) * size + x1) * 4 + c];
+                dst[(size_t(y) * half + x) * 4 + c] = uint8_t((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+size_t TextureCodec::bc1Bytes(int size) {
+    int blocks = (size + 3) / 4;
+    return size_t(blocks) * blocks * 8;
+}
+
+std::vector<uint8_t> TextureCodec::encodeBC1(const std::vector<uint8_t> &rgba, int size) {
+    int blocks = (size + 3) / 4;
+    std::vector<uint8_t> out(bc1Bytes(size));
+
+    for (int by = 0; by < blocks; by++) {
+        for (int bx = 0; bx < blocks; bx++) {
+            glm::vec3 texels[16];
+            for (int i = 0; i < 16; i++) {
+                // Blocks hanging over the edge of tiny mips repeat the last texel
+                int x = std::min(bx * 4 + i % 4, size - 1);
+                int y = std::min(by * 4 + i / 4, size - 1);
+                const uint8_t *p = &rgba[(size_t(y) * size + x) * 4];
+                texels[i] = glm::vec3(p[0], p[1], p[2]);
+            }
+            encodeBlock(texels, &out[(size_t(by) * blocks + bx) * 8]);
+        }
+    }
+    return out;
+}
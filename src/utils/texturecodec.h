@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU side texture processing shared by the texture caches: mip reduction and a BC1 (DXT1)
+// block encoder, so compressed textures can be produced without any GPU support.
+class TextureCodec {
+public:
+    // 2x2 box filter of a size x size RGBA8 image
+    static std::vector<uint8_t> halve(const std::vector<uint8_t> &rgba, int size);
+
+    // BC1 blocks of a size x size RGBA8 image, alpha is dropped. Sizes below 4 still take a block.
+    static std::vector<uint8_t> encodeBC1(const std::vector<uint8_t> &rgba, int size);
+    static size_t bc1Bytes(int size);
+};
@@ -0,0 +1,196 @@
+#include "texturemanager.h"
+#include "ktx2.h"
+#include "texturecodec.h"
+#include "cachefile.h"
+
+#include <QImage>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+int mipCount() {
+    int levels = 1;
+    for (int size = TextureManager::LAYER_SIZE; size > 1; size /= 2) levels++;
+    return levels;
+}
+
+}
+
+void TextureManager::init() {
+    m_compressed = GLEW_EXT_texture_compression_s3tc;
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    int size = LAYER_SIZE;
+    for (int level = 0; level < mipCount(); level++) {
+        if (m_compressed) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, size, size, MAX_LAYERS,
+                                   0, TextureCodec::bc1Bytes(size) * MAX_LAYERS, NULL);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, MAX_LAYERS, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        size = std::max(size / 2, 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Keeps tiled textures at grazing angles sharp without aliasing
+    if (GLEW_EXT_texture_filter_anisotropic) {
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8.f);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_layers.assign(MAX_LAYERS, std::string());
+    m_pool.setMaxThreadCount(2);
+}
+
+void TextureManager::destroy() {
+    // Workers write into m_decoded, so they have to finish first
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+    m_entries.clear();
+    m_layers.clear();
+    m_decoded.clear();
+}
+
+int TextureManager::request(const std::string &filepath) {
+    Entry &entry = m_entries[filepath];
+    entry.lastUsed = m_frame;
+    if (entry.layer >= 0 || entry.loading || entry.failed) {
+        return entry.layer;
+    }
+
+    entry.loading = true;
+    bool compressed = m_compressed;
+    m_pool.start([this, filepath, compressed]() {
+        Decoded decoded;
+        decoded.filepath = filepath;
+        decode(decoded, compressed);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.push_back(std::move(decoded));
+    });
+    return -1;
+}
+
+void TextureManager::decode(Decoded &decoded, bool compressed) {
+    QString source = QString::fromStdString(decoded.filepath);
+    QString cache = CacheFile::path(source, "textures", compressed ? "_bc1.ktx2" : ".ktx2");
+    // Layers are resized, so the layer size is part of what the cache was made from
+    std::string stamp = CacheFile::stamp(source) + " " + std::to_string(TextureManager::LAYER_SIZE);
+    Ktx2::Image cached;
+    if (Ktx2::read(cache, stamp, cached) && cached.size == LAYER_SIZE && cached.levels.size() == mipCount()
+        && cached.format == (compressed ? Ktx2::FORMAT_BC1 : Ktx2::FORMAT_RGBA8)) {
+        decoded.mips = std::move(cached.levels);
+        return;
+    }
+
+    QImage img(QString::fromStdString(decoded.filepath));
+    if (img.isNull()) {
+        std::cerr << "[Textures] Failed to load image " << decoded.filepath << std::endl;
+        return;
+    }
+    // Every layer has the same size, OpenGL's rows start at the bottom
+    img = img.convertToFormat(QImage::Format_RGBA8888)
+              .scaled(LAYER_SIZE, LAYER_SIZE, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+              .mirrored();
+
+    std::vector<uint8_t> level(size_t(LAYER_SIZE) * LAYER_SIZE * 4);
+    for (int y = 0; y < LAYER_SIZE; y++) {
+        memcpy(level.data() + size_t(y) * LAYER_SIZE * 4, img.constScanLine(y), LAYER_SIZE * 4);
+    }
+    decoded.mips.push_back(std::move(level));
+
+    // Box filtered mip chain, built here rather than with glGenerateMipmap on the whole array
+    for (int size = LAYER_SIZE; size > 1; size /= 2) {
+        decoded.mips.push_back(TextureCodec::halve(decoded.mips.back(), size));
+    }
+    if (compressed) {
+        int size = LAYER_SIZE;
+        for (std::vector<uint8_t> &mip : decoded.mips) {
+            mip = TextureCodec::encodeBC1(mip, size);
+            size = std::max(size / 2, 1);
+        }
+    }
+
+    Ktx2::Image image;
+    image.format = compressed ? Ktx2::FORMAT_BC1 : Ktx2::FORMAT_RGBA8;
+    image.size = LAYER_SIZE;
+    image.levels = decoded.mips;
+    Ktx2::write(cache, image, stamp);
+}
+
+int TextureManager::evict() {
+    int oldest = -1;
+    for (int layer = 0; layer < m_layers.size(); layer++) {
+        auto entry = m_entries.find(m_layers[layer]);
+        if (entry == m_entries.end()) return layer;
+        // beginFrame runs before this frame's requests, so last frame's textures are still needed
+        if (entry->second.lastUsed >= m_frame - 1) continue;
+        if (oldest < 0 || entry->second.lastUsed < m_entries[m_layers[oldest]].lastUsed) {
+            oldest = layer;
+        }
+    }
+    if (oldest >= 0) {
+        // Loaded again from disk if it is ever drawn again
+        m_entries[m_layers[oldest]].layer = -1;
+    }
+    return oldest;
+}
+
+void TextureManager::beginFrame() {
+    m_frame++;
+
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int count = std::min<int>(m_decoded.size(), UPLOADS_PER_FRAME);
+        ready.assign(std::make_move_iterator(m_decoded.begin()), std::make_move_iterator(m_decoded.begin() + count));
+        m_decoded.erase(m_decoded.begin(), m_decoded.begin() + count);
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    for (Decoded &decoded : ready) {
+        Entry &entry = m_entries[decoded.filepath];
+        if (decoded.mips.empty()) {
+            entry.loading = false;
+            entry.failed = true;
+            continue;
+        }
+
+        int layer = -1;
+        for (int i = 0; i < m_layers.size() && layer < 0; i++) {
+            if (m_layers[i].empty()) layer = i;
+        }
+        if (layer < 0) layer = evict();
+        if (layer < 0) {
+            // Everything resident is in use, try again next frame
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoded.push_back(std::move(decoded));
+            continue;
+        }
+
+        int size = LAYER_SIZE;
+        for (int level = 0; level < decoded.mips.size(); level++) {
+            if (m_compressed) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1,
+                                          GL_COMPRESSED_RGB_S3TC_DXT1_EXT, decoded.mips[level].size(), decoded.mips[level].data());
+            } else {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, decoded.mips[level].data());
+            }
+            size = std::max(size / 2, 1);
+        }
+        m_layers[layer] = decoded.filepath;
+        entry.layer = layer;
+        entry.loading = false;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <QThreadPool>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Material textures, streamed into the layers of one mipmapped texture array so every shape
+// samples the same sampler and switching textures is just a uniform. Images are decoded,
+// resized to the layer size, mipmapped and BC1 compressed (when the GPU supports it) on worker
+// threads, each file only once however many shapes use it. The result is cached as KTX2, so
+// later runs upload the compressed mips straight from disk. When every layer is taken, the
+// least recently drawn texture gives up its layer.
+class TextureManager
+{
+public:
+    static const int LAYER_SIZE = 512;
+    static const int MAX_LAYERS = 32;        // Residency budget, about 1.4 MB per layer (0.2 MB as BC1)
+    static const int UPLOADS_PER_FRAME = 4;  // Spreads a burst of new textures over a few frames
+
+    // Called with the context current
+    void init();
+    void destroy();
+
+    // Uploads what the workers finished since last frame. Called once per frame before drawing.
+    void beginFrame();
+
+    // Layer holding the image, or -1 while it is still loading (or failed to). The first
+    // request starts loading it; every request keeps it resident for this frame.
+    int request(const std::string &filepath);
+
+    GLuint texture() const { return m_texture; }
+
+private:
+    struct Entry {
+        int layer = -1;
+        bool loading = false;
+        bool failed = false;
+        int lastUsed = 0;
+    };
+    // Output of a worker: RGBA8 or BC1 mip chain of one image, largest level first
+    struct Decoded {
+        std::string filepath;
+        std::vector<std::vector<uint8_t>> mips;
+    };
+
+    static void decode(Decoded &decoded, bool compressed);
+    // Frees the least recently used layer not drawn last frame, -1 if there is none
+    int evict();
+
+    GLuint m_texture = 0;
+    bool m_compressed = false;           // Layers are BC1 rather than RGBA8
+    int m_frame = 0;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::vector<std::string> m_layers;   // Image in each layer, empty when free
+
+    QThreadPool m_pool;
+    std::mutex m_mutex;
+    std::vector<Decoded> m_decoded;      // Guarded by m_mutex
+};